@@ -45,49 +45,15 @@
 #include "checkpoint.h"
 #include "mpatch.h"
 
-#define MSPI_TEST_MODULE 0
-
-#if defined(AM_PART_APOLLO3)
-#define MSPI_XIP_BASE_ADDRESS 0x04000000
-#define MSPI_XIPMM_BASE_ADDRESS 0x51000000
-#define MSPI_XIPMM_SIZE 0x100000
-#elif defined(AM_PART_APOLLO3P)
-#define MSPI_XIP_BASE_ADDRESS 0x02000000
-#endif
-
 //#define START_SPEED_INDEX       0
 //#define END_SPEED_INDEX         11
 
-CHECKPOINT_EXCLUDE_BSS uint32_t DMATCBBuffer[2560];
-
-const am_hal_mspi_dev_config_t MSPI_Flash_Serial_CE0_MSPIConfig = {
-    .eSpiMode = AM_HAL_MSPI_SPI_MODE_0,
-    .eClockFreq = AM_HAL_MSPI_CLK_24MHZ,
-    .ui8TurnAround = 0,
-    .eAddrCfg = AM_HAL_MSPI_ADDR_3_BYTE,
-    .eInstrCfg = AM_HAL_MSPI_INSTR_1_BYTE,
-    .eDeviceConfig = AM_HAL_MSPI_FLASH_SERIAL_CE0,
-    .bSeparateIO = true,
-    .bSendInstr = true,
-    .bSendAddr = true,
-    .bTurnaround = true,
-    .ui8ReadInstr = FRAM_READ_MEM_CODE,
-    .ui8WriteInstr = FRAM_WRITE_MEM_CODE,
-    .ui32TCBSize = (sizeof(DMATCBBuffer) / sizeof(uint32_t)),
-    .pTCB = DMATCBBuffer,
-    .scramblingStartAddr = 0,
-    .scramblingEndAddr = 0,
-};
-
 #ifdef CHECKPOINT
 extern void startup_clear_data(void);
 extern void startup_clear_bss(void);
 #endif
 
 int init(void) {
-  uint32_t ui32Status;
-  void* pHandle = NULL;
-
   //
   // Set the clock frequency.
   //
@@ -143,54 +109,14 @@ int init(void) {
 
 
   //
-  // Configure the MSPI and Flash Device.
-  //
-  ui32Status = am_devices_mspi_psram_init(
-      MSPI_TEST_MODULE,
-      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig, &pHandle);
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf(
-        "Failed to configure the MSPI and Flash Device correctly!\n");
-    return -1;
-  }
-
-  //
-  // Set up for XIP operation.
+  // Configure the MSPI and FRAM, and enable XIP.
   //
-  ui32Status = am_devices_mspi_psram_enable_xip();
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to enable XIP mode in the MSPI!\n");
-    return -2;
-  }
-
-  return 0;
+  return framConfig();
 }
 
 int deinit(void) {
-  uint32_t ui32Status;
-
-  //
-  // Shutdown XIP operation.
-  //
   am_util_stdio_printf("Disabling the MSPI and External Flash from XIP mode\n");
-  ui32Status = am_devices_mspi_psram_disable_xip();
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to disable XIP mode in the MSPI!\n");
-    return -2;
-  }
-
-  //
-  // Clean up the MSPI before exit.
-  //
-  ui32Status = am_devices_mspi_psram_deinit(
-      MSPI_TEST_MODULE,
-      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig);
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to shutdown the MSPI and Flash Device!\n");
-    return -1;
-  }
-
-  return 0;
+  return framShutdown(false);
 }
 
 //*****************************************************************************
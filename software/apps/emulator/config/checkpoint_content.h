@@ -10,6 +10,7 @@
 #include "checkpoint_mpatch.h"
 #include "checkpoint_memtracker.h"
 #include "checkpoint_emulator.h"
+#include "external_ram.h"
 
 __attribute__((always_inline))
 static inline void CHECKPOINT_SETUP_CONTENT(void) {
@@ -25,6 +26,9 @@ static inline void CHECKPOINT_CONTENT(void) {
   checkpoint_bss();
   checkpoint_stack();
   checkpoint_memtracker();
+#if EXTERNAL_RAM
+  checkpoint_external_ram();
+#endif
   checkpoint_mpatch();
   checkpoint_registers(); // MUST BE LAST
 }
@@ -36,9 +40,18 @@ __attribute__((always_inline))
 static inline void CHECKPOINT_RESTORE_CONTENT(void) {
   restore_data();
   restore_bss();
+  restore_emulator_early(); // Display powers up during the rest of the restore
   restore_stack();
+#if LAZY_RESTORE
+  restore_mpatch_deferred();
+  restore_memtracker(); // VRAM and OAM/IO first, the rest on demand
+#if EXTERNAL_RAM
+  restore_external_ram();
+#endif
+#else
   restore_mpatch();
-  restore_emulator();
+#endif
+  restore_emulator(); // Interrupts only once the state is restored
   restore_registers(); // MUST BE LAST
 }
 
@@ -56,6 +69,9 @@ static inline void POST_CHECKPOINT_CONTENT(void) {
 __attribute__((always_inline))
 static inline void POST_CHECKPOINT_AND_RESTORE_CONTENT(void) {
   post_checkpoint_memtracker();
+#if EXTERNAL_RAM
+  post_checkpoint_external_ram();
+#endif
 }
 
 #endif /* CHECKPOINT_CONTENT_H_ */
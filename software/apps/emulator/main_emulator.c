@@ -8,57 +8,26 @@
 
 #include "am_mcu_apollo.h"
 #include "am_util.h"
+#include "boot_timing.h"
 #include "checkpoint.h"
 #include "checkpoint_memtracker.h"
 #include "emulator.h"
 #include "emulator_settings.h"
+#include "external_ram.h"
 #include "fram.h"
+#include "library.h"
 #include "mpatch.h"
 #include "mspi.h"
 #include "platform.h"
 #include "reader.h"
 #include "z80_ub.h"
 
-#define MSPI_TEST_MODULE 0
-
-#if defined(AM_PART_APOLLO3)
-#define MSPI_XIP_BASE_ADDRESS 0x04000000
-#define MSPI_XIPMM_BASE_ADDRESS 0x51000000
-#define MSPI_XIPMM_SIZE 0x100000
-#elif defined(AM_PART_APOLLO3P)
-#define MSPI_XIP_BASE_ADDRESS 0x02000000
-#endif
-
-CHECKPOINT_EXCLUDE_BSS uint32_t DMATCBBuffer_FRAM[2560];
-
-const am_hal_mspi_dev_config_t MSPI_Flash_Serial_CE0_MSPIConfig = {
-    .eSpiMode = AM_HAL_MSPI_SPI_MODE_0,
-    .eClockFreq = AM_HAL_MSPI_CLK_24MHZ,
-    .ui8TurnAround = 0,
-    .eAddrCfg = AM_HAL_MSPI_ADDR_3_BYTE,
-    .eInstrCfg = AM_HAL_MSPI_INSTR_1_BYTE,
-    .eDeviceConfig = AM_HAL_MSPI_FLASH_SERIAL_CE0,
-    .bSeparateIO = true,
-    .bSendInstr = true,
-    .bSendAddr = true,
-    .bTurnaround = true,
-    .ui8ReadInstr = FRAM_READ_MEM_CODE,
-    .ui8WriteInstr = FRAM_WRITE_MEM_CODE,
-    .ui32TCBSize = (sizeof(DMATCBBuffer_FRAM) / sizeof(uint32_t)),
-    .pTCB = DMATCBBuffer_FRAM,
-    .scramblingStartAddr = 0,
-    .scramblingEndAddr = 0,
-};
-
 #ifdef CHECKPOINT
 extern void startup_clear_data(void);
 extern void startup_clear_bss(void);
 #endif
 
 int init(void) {
-  uint32_t ui32Status;
-  void* pHandle = NULL;
-
   //
   // Set the clock frequency.
   //
@@ -120,66 +89,29 @@ int init(void) {
   am_hal_burst_mode_e eBurstMode;
   if (eBurstModeAvailable == AM_HAL_BURST_AVAIL) {
     am_hal_burst_mode_enable(&eBurstMode);  // operate at 96MHz
-    am_util_stdio_printf("Enabled burst operation\n");
-  } else {
-    am_util_stdio_printf("Burst not availible\n");
   }
+  bootTimingMark(BOOT_PHASE_CORE);
 
   //
-  // Configure the MSPI and Flash Device.
+  // Configure the MSPI and FRAM, and enable XIP.
   //
-  ui32Status = am_devices_mspi_psram_init(
-      MSPI_TEST_MODULE,
-      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig, &pHandle);
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf(
-        "Failed to configure the MSPI and Flash Device correctly!\n");
-    return -1;
-  }
-
-  //
-  // Set up for XIP operation.
-  //
-  ui32Status = am_devices_mspi_psram_enable_xip();
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to enable XIP mode in the MSPI!\n");
-    return -2;
-  }
+  int status = framConfig();
+  bootTimingMark(BOOT_PHASE_FRAM);
 
-  return 0;
+  // No printing on the way to a restore, burst mode is reported later
+  return status;
 }
 
 int deinit(void) {
-  uint32_t ui32Status;
-
-  //
-  // Shutdown XIP operation.
-  //
   am_util_stdio_printf("Disabling the MSPI and External Flash from XIP mode\n");
-  ui32Status = am_devices_mspi_psram_disable_xip();
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to disable XIP mode in the MSPI!\n");
-    return -2;
-  }
-
-  //
-  // Clean up the MSPI before exit.
-  //
-  ui32Status = am_devices_mspi_psram_deinit(
-      MSPI_TEST_MODULE,
-      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig);
-  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
-    am_util_stdio_printf("Failed to shutdown the MSPI and Flash Device!\n");
-    return -1;
-  }
-
-  return 0;
+  return framShutdown(false);
 }
 
 int main(void) {
-  init();
+  bool librarySwitch = false;
 
-  am_util_stdio_printf("Emulator Checkpoint Test\n\n");
+  bootTimingStart();
+  init();
 
 #ifdef CHECKPOINT
   /* Restore overwrite (i.e. restart the game) */
@@ -195,6 +127,46 @@ int main(void) {
     checkpoint_restore_invalidate();
   }
 
+#if ROM_LIBRARY
+  am_hal_gpio_pinconfig(BUTTON_B, g_AM_HAL_GPIO_INPUT);
+
+  bool switchGame = (am_hal_gpio_input_read(BUTTON_SELECT) == 0) &&
+                    (am_hal_gpio_input_read(BUTTON_B) == 0);
+#if EXTERNAL_RAM
+  if (switchGame && checkpoint_restore_available() &&
+      externalRamCheckpointUnsaved()) {
+    // The save of the game is only in the checkpoint, it would be lost
+    am_util_stdio_printf(
+        "Game save not on the cartridge, no library switch\n\n");
+    switchGame = false;
+  }
+#endif
+
+  if (switchGame) {
+    // Switch to the next game of the library, it starts from the beginning
+    uint8_t game = romLibrarySelectNext();
+    am_util_stdio_printf("Switch to library game %d\n\n", game);
+    checkpoint_restore_invalidate();
+    librarySwitch = true;
+#if CARTRIDGE_LAZY
+    cartridgeLazyCancel();
+#endif
+  }
+#endif
+
+#if CARTRIDGE_LAZY
+  // The missing banks of a lazy dump are read while playing, also after a
+  // restore (no cartridge access until then)
+  cartridgeLazyRestore();
+#endif
+
+  bool readCartridge = (am_hal_gpio_input_read(BUTTON_START) == 0) &&
+                       (am_hal_gpio_input_read(BUTTON_A) == 0);
+  if (readCartridge && checkpoint_restore_available()) {
+    // The checkpoint belongs to the game that is in flash now
+    checkpoint_restore_invalidate();
+  }
+
   if (!checkpoint_restore_available()) {
     // First boot
     // Init the .bss and .data (no-restore parts already init in startup)
@@ -205,31 +177,48 @@ int main(void) {
     // Zero the remaining .bss
     startup_clear_bss();
 
-    if (checkSavedCartridge((uint8_t*)GameRomStart)) {
+    if (checkSavedCartridge((uint8_t*)cartridgeRomStart())) {
       emulatorSetRomSize(cartridgeGetSizeBytes());
     } else {
       emulatorSetRomSize(0);
     }
+
+#if CARTRIDGE_RESUME
+    // Continue a dump that was cut off by a power failure (unless another
+    // game of the library was chosen or the cartridge was removed). Not when
+    // a game is restored, the checkpoint belongs to the game in flash.
+    readCartridge =
+        readCartridge || (!librarySwitch && cartridgeResumeAvailable());
+#endif
   }
 
-  if ((am_hal_gpio_input_read(BUTTON_START) == 0) &&
-      (am_hal_gpio_input_read(BUTTON_A) == 0)) {
+  if (readCartridge) {
     // Read cartridge
     am_util_stdio_printf(
         "Reading cartridge to memory, takes up to 1-10 mins! \n\n");
     cartridgeConfig();
 
     cartridgeReadInfo();
+#if CARTRIDGE_LAZY
+    cartridgeReadRomLazy();
+#else
     cartridgeReadRom();
+#endif
     emulatorSetRomSize(cartridgeGetSizeBytes());
   }
 
-  am_util_stdio_printf("Checkpoint setup (always)\n");
   checkpoint_setup();
+  bootTimingMark(BOOT_PHASE_SETUP);
 
-  am_util_stdio_printf("Attempting restore\n\n");
+  // Does not return when a checkpoint is available
   checkpoint_restore();
 
+  am_util_stdio_printf("Emulator Checkpoint Test\n\n");
+  if (am_hal_burst_mode_status() == AM_HAL_BURST_MODE) {
+    am_util_stdio_printf("Enabled burst operation\n");
+  } else {
+    am_util_stdio_printf("Burst not availible\n");
+  }
   am_util_stdio_printf("No restore available\n\n");
 
   am_util_stdio_printf("One-time checkpoint setup\n");
@@ -238,14 +227,24 @@ int main(void) {
   emulatorConfigIO();
   emulatorSetup();
 
+#if EXTERNAL_RAM
+  // Start with the save of the cartridge (when it is inserted)
+  externalRamImport();
+#endif
+
   // First time setup (has to be after the emulatorInit()
   setup_memtracker();
 
   // Add the z80 memory as a "starting state"
   checkpoint_memtracker_default();
+#if EXTERNAL_RAM
+  checkpoint_external_ram_default();
+#endif
 
   am_util_stdio_printf("After init checkpoint\n\n");
-  checkpoint();
+  if (checkpoint()) {
+    emulatorResume();
+  }
 
   checkpoint_restore_set_availible();
 
@@ -253,6 +252,7 @@ int main(void) {
   emulatorRun();
 
 #else
+  am_util_stdio_printf("Emulator Checkpoint Test\n\n");
   emulatorSetup();
   emulatorRun();
 #endif
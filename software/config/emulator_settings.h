@@ -9,13 +9,45 @@
 #ifndef CONFIG_EMULATORSETTINGS_H_
 #define CONFIG_EMULATORSETTINGS_H_
 
-#define SUPPORTED_MBC_VERSION 1  // [0=w/o MBC, 1=MBC1]
+#define SUPPORTED_MBC_VERSION 1  // [0=w/o MBC, 1=MBC1, see MBC_EXTENDED]
 
 //--------------------------------------------------------------
 // Opcode GOTO
 //-------------------------------------------------------------
 #define OPCODE_GOTO 1
 
+//--------------------------------------------------------------
+// Block cache (requires OPCODE_GOTO)
+//-------------------------------------------------------------
+// Decode basic blocks of ROM code once and run them without the timer, LCD
+// and interrupt bookkeeping between their instructions.
+#define BLOCK_CACHE 1
+#define BLOCK_CACHE_SIZE 256  // cached blocks, power of 2
+#define BLOCK_MAX_LENGTH 8    // instructions per block
+#define BLOCK_MAX_CYCLES 32   // latency bound, unused with BATCH_EXECUTION
+
+// Run the CPU core in a tight loop until the next timer, divider or LCD mode
+// event and do the bookkeeping once per batch instead of per instruction
+// (requires OPCODE_GOTO).
+#define BATCH_EXECUTION 1
+
+// Compute the flags of INC/DEC r and the 8bit ADD/SUB/AND/OR/XOR/CP only
+// when an instruction reads them (requires OPCODE_GOTO).
+#define LAZY_FLAGS 1
+
+// Keep ROM bank 0 and the most recently used switchable banks (16KB each) in
+// SRAM instead of reading them from flash.
+#define ROM_CACHE 1
+#define ROM_CACHE_SLOTS 3
+
+// Decode the background and window tiles a whole tile line (8 pixel) at a
+// time with lookup tables instead of pixel by pixel.
+#define TILE_LUT 1
+
+// Keep the decoded background tile lines (all 384 tiles) in SRAM. A line is
+// decoded again after a write into its tile data (requires TILE_LUT).
+#define TILE_CACHE 1
+
 // Define JIT threshold in mV
 // System turns off at 3.4V and when measuring has a 1/3 divider so
 // always divide by 3!
@@ -24,8 +56,53 @@
 // 3.6 / 3 * 1000 (to mV) = 1200
 #define jitTriggermV 3500
 
+// Energy forecasting for the JIT trigger (0 = window comparator only)
+// The JIT module tracks the slope of the supply voltage and checkpoints when
+// the projected time-to-brownout drops below the predicted checkpoint time.
+// The comparator at jitTriggermV stays as a hard floor, but is ignored while
+// the device is clearly being charged.
+#define JIT_FORECAST 1
+#define jitBrownoutmV 3400           // same units as jitTriggermV
+#define JIT_FORECAST_MARGIN 2        // safety factor on the checkpoint time
+#define JIT_CHECKPOINT_INITIAL_MS 40 // prior until a checkpoint is measured
+#define JIT_CHARGING_SLOPE 20        // in mV/s, above this we are charging
+
+// Hibernate after a JIT checkpoint instead of running until the power
+// collapses (0 = disabled). Wakes up on a button press or once the voltage
+// recovered, continuing from SRAM without a restore.
+#define HIBERNATE 1
+#define hibernateWakemV 3700        // same units as jitTriggermV
+#define HIBERNATE_HYSTERESIS_MV 100 // wake-up at least this much above sleep
+
+// Skip the rendering of frames when the supply voltage is low, the CPU keeps
+// running at full speed (0 = render every frame).
+#define FRAME_SKIP 1
+#define FRAME_SKIP_FULL_MV 3900       // same units as jitTriggermV
+#define FRAME_SKIP_INTERLACE_MV 3650  // below, render every other line
+#define FRAME_SKIP_MAX 4              // render at least every Nth frame
+
 #define BUTTON_ACTIVE_PERIOD 300  // in ms
 
+// Queue every button press with its time and sample the joypad state when the
+// game selects a row of P1, with a debounce period per button (0 = one
+// debounce timer per row, the last press of a row wins).
+#define BUTTON_EVENTS 1
+#define BUTTON_QUEUE_SIZE 8  // presses between two samples
+#define BUTTON_LATENCY_REPORT 0  // print the press to sample latency
+
+#define BOOT_TIMING_REPORT 0  // print the boot phase timing once booted
+
+// Print the PC every PC_SAMPLING_PERIOD core clock cycles (SysTick) for
+// scripts/hot_functions.py, which picks the functions that run from SRAM.
+#define PC_SAMPLING 0
+#define PC_SAMPLING_PERIOD 48017  // prime, does not alias with the frame loop
+
+// Restore the emulated memory in order of priority (0 = all at once).
+// VRAM and OAM/IO/HRAM are restored before the emulation continues, the other
+// memory regions (4KB each) on their first access or in the background.
+#define LAZY_RESTORE 1
+#define LAZY_RESTORE_INTERVAL 4096  // in emulator steps per region
+
 //#define ENABLE_ENERGY_BAR // enable to render a battery bar on the screen.
 
 #define BW_THRESHOLD 0xf000
@@ -45,6 +122,60 @@
 
 //#define BLOCKING_WRITES // Uncomment for blocking writes
 
+// Only send the display lines that changed since they were last sent, in
+// bursts of consecutive lines (color LCD only).
+#define DIRTY_LINES 1
+
+// Send display lines from two transfer buffers instead of the live display
+// buffer, the renderer waits when both are still being sent.
+#define DISPLAY_PIPELINE 1
+
+// Pack the lines to 3 bits (lossless) or, below DISPLAY_1BIT_MV, to 1 bit per
+// pixel while copying them into the transfer buffers (requires LCD_COLOR,
+// DISPLAY_PIPELINE and FRAME_SKIP, the mode is chosen per frame).
+#define DISPLAY_COLOR_MODES 1
+#define DISPLAY_1BIT_MV 3600  // same units as jitTriggermV
+
+// Read the next ROM page from the cartridge while the previous one is
+// programmed into flash, in steps of CARTRIDGE_PROGRAM_CHUNK words between the
+// (non-blocking) I2C transfers. The flash is erased before the dump.
+#define CARTRIDGE_PIPELINE 1
+#define CARTRIDGE_PROGRAM_CHUNK 8  // in 32bit words
+
+// Record the progress of the dump (a CRC per flash page) in flash, a dump that
+// was cut off by a power failure continues at the first missing page.
+#define CARTRIDGE_RESUME 1
+// Pages read again from a cartridge that is already in flash, to check that
+// the image belongs to it (0 = trust the header). Pages that differ are read
+// again, the rest of the dump is skipped.
+#define CARTRIDGE_VERIFY_SAMPLES 2
+
+// Only read ROM bank 0 before playing, the other banks are read from the
+// cartridge into flash the first time they are mapped. The cartridge has to
+// stay inserted (requires CARTRIDGE_RESUME and ROM_CACHE).
+#define CARTRIDGE_LAZY 0
+
+// Keep several dumped ROMs in GBMEM with a directory in flash (requires
+// CARTRIDGE_RESUME). Holding SELECT and B at power-up switches to the next one,
+// the checkpoint only holds the state of the game that is played. With
+// EXTERNAL_RAM the switch is refused while the save is only in the checkpoint.
+#define ROM_LIBRARY 1
+
+// Emulate the cartridge RAM (0xA000-0xBFFF) in EXTERNAL_RAM_BANKS banks of 8KB
+// with the MBC1 RAM banking. It is checkpointed in its own MPatch chain, only
+// the 512 byte blocks written since the last checkpoint. The RAM of the
+// inserted cartridge is read when a game starts from the beginning.
+#define EXTERNAL_RAM 1
+#define EXTERNAL_RAM_BANKS 4
+// Write the changed blocks back to the cartridge when the game disables the
+// RAM (after a save), so the save outlives the checkpoint and a new dump.
+#define EXTERNAL_RAM_WRITEBACK 1
+
+// Also emulate the MBC2, MBC3 and MBC5 memory bank controllers (requires
+// SUPPORTED_MBC_VERSION 1 and EXTERNAL_RAM). The MBC3 clock counts the emulated
+// frames, so it stands still while the device is off.
+#define MBC_EXTENDED 1
+
 //#define TRACKING_COUNT_WRITES // Enable counting writes in z80 memory
 
 #endif /* CONFIG_EMULATORSETTINGS_H_ */
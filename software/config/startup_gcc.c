@@ -228,6 +228,9 @@ extern uint32_t _sdata;
 extern uint32_t _edata;
 extern uint32_t _sbss;
 extern uint32_t _ebss;
+extern uint32_t _init_ramfunc;
+extern uint32_t _sramfunc;
+extern uint32_t _eramfunc;
 
 #ifdef CHECKPOINT
 extern uint32_t _sdata_norestore;
@@ -299,6 +302,19 @@ Reset_Handler(void)
           "isb\n");
 #endif
 
+    //
+    // Copy the SRAM functions from flash, also before a restore.
+    //
+    __asm("    ldr     r0, =_init_ramfunc\n"
+          "    ldr     r1, =_sramfunc\n"
+          "    ldr     r2, =_eramfunc\n"
+          "ramfunc_loop:\n"
+          "        cmp     r1, r2\n"
+          "        ittt    lt\n"
+          "        ldrlt   r3, [r0], #4\n"
+          "        strlt   r3, [r1], #4\n"
+          "        blt     ramfunc_loop\n");
+
 #ifndef CHECKPOINT
     //
     // Copy the data segment initializers from flash to SRAM.
@@ -0,0 +1,60 @@
+/*
+ * boot_timing.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "boot_timing.h"
+
+#include "am_util.h"
+#include "platform.h"
+
+// Only valid for the current boot, so never restored
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t bootTimestamps[BOOT_PHASE_COUNT];
+
+/*
+ * Start the system timer, also used by the JIT and the display bring-up.
+ * Must be the first thing after reset.
+ */
+void bootTimingStart(void) {
+  am_hal_stimer_config(AM_HAL_STIMER_CFG_CLEAR | AM_HAL_STIMER_CFG_FREEZE);
+  am_hal_stimer_config(AM_HAL_STIMER_CFG_THAW | AM_HAL_STIMER_HFRC_3MHZ);
+
+  for (uint32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    bootTimestamps[i] = 0;
+  }
+}
+
+void bootTimingMark(BootPhase phase) {
+  // Only the first time a phase is reached counts
+  if (bootTimestamps[phase] == 0) {
+    bootTimestamps[phase] = am_hal_stimer_counter_get();
+  }
+}
+
+uint32_t bootTimingGet(BootPhase phase) {
+  return bootTimestamps[phase] / BOOT_TICKS_PER_US;
+}
+
+void bootTimingReport(void) {
+#if BOOT_TIMING_REPORT
+  static const char* const bootPhaseNames[BOOT_PHASE_COUNT] = {
+      "core", "fram", "setup", "io", "restore", "display",
+  };
+  uint32_t previous = 0;
+
+  for (uint32_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    if (bootTimestamps[i] == 0) {
+      am_util_stdio_printf("[boot] %s: -\n", bootPhaseNames[i]);
+      continue;
+    }
+    uint32_t us = bootTimestamps[i] / BOOT_TICKS_PER_US;
+    am_util_stdio_printf("[boot] %s: %u us (+%u us)\n", bootPhaseNames[i], us,
+                         us - previous);
+    previous = us;
+  }
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+ * boot_timing.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef LIBS_BOOT_BOOT_TIMING_H_
+#define LIBS_BOOT_BOOT_TIMING_H_
+
+#include "am_mcu_apollo.h"
+#include "emulator_settings.h"
+
+// The system timer runs from the HFRC at 3MHz
+#define BOOT_TICKS_PER_US 3
+
+typedef enum {
+  BOOT_PHASE_CORE,        // clocks, cache and power
+  BOOT_PHASE_FRAM,        // MSPI and FRAM in XIP mode
+  BOOT_PHASE_SETUP,       // checkpoint setup, ready to restore
+  BOOT_PHASE_IO,          // peripheral bring-up started (during restore)
+  BOOT_PHASE_RESTORE,     // execution resumed from the checkpoint
+  BOOT_PHASE_DISPLAY,     // display powered up and enabled
+  BOOT_PHASE_COUNT
+} BootPhase;
+
+void bootTimingStart(void);
+void bootTimingMark(BootPhase phase);
+uint32_t bootTimingGet(BootPhase phase);  // in us since reset, 0 if not reached
+void bootTimingReport(void);
+
+#endif /* LIBS_BOOT_BOOT_TIMING_H_ */
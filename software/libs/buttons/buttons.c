@@ -8,7 +8,10 @@
 
 #include "buttons.h"
 
+#include "am_util.h"
 #include "emulator_settings.h"
+#include "jit_checkpoint.h"
+#include "platform.h"
 
 #define BUTTON_A_MASK ((uint64_t)0x1 << BUTTON_A)
 #define BUTTON_B_MASK ((uint64_t)0x1 << BUTTON_B)
@@ -21,6 +24,134 @@
 #define BUTTON_START_MASK ((uint64_t)0x1 << BUTTON_START)
 #define BUTTON_SELECT_MASK ((uint64_t)0x1 << BUTTON_SELECT)
 
+#if BUTTON_EVENTS
+// Joypad state in the layout of P1 (a set bit is a pressed button), the
+// buttons in the low nibble and the cursor in the high nibble
+#define ButtonBit(code) ((KEYCODE_BTN_NONE ^ (code)) & 0x0F)
+#define CursorBit(code) (((KEYCODE_CURSOR_NONE ^ (code)) & 0x0F) << 4)
+#define ButtonCount 8
+
+#define ButtonTicksPerUs 3  // stimer, see bootTimingStart()
+#define ButtonActiveTicks (BUTTON_ACTIVE_PERIOD * 1000 * ButtonTicksPerUs)
+
+typedef struct {
+  uint8_t buttons;  // pressed in the same interrupt
+  uint32_t time;    // stimer
+} ButtonEvent;
+
+static const uint8_t buttonPins[ButtonCount] = {
+    BUTTON_A,     BUTTON_B,    BUTTON_SELECT, BUTTON_START,
+    BUTTON_RIGHT, BUTTON_LEFT, BUTTON_UP,     BUTTON_DOWN,
+};
+static const uint8_t buttonBits[ButtonCount] = {
+    ButtonBit(KEYCODE_BTN_A),         ButtonBit(KEYCODE_BTN_B),
+    ButtonBit(KEYCODE_BTN_SELECT),    ButtonBit(KEYCODE_BTN_START),
+    CursorBit(KEYCODE_CURSOR_RIGHT),  CursorBit(KEYCODE_CURSOR_LEFT),
+    CursorBit(KEYCODE_CURSOR_UP),     CursorBit(KEYCODE_CURSOR_DOWN),
+};
+
+// Presses from before a power failure are stale, so never restored
+CHECKPOINT_EXCLUDE_BSS
+static ButtonEvent buttonQueue[BUTTON_QUEUE_SIZE];
+CHECKPOINT_EXCLUDE_BSS
+static volatile uint8_t buttonQueueHead;  // written by the interrupt
+CHECKPOINT_EXCLUDE_BSS
+static volatile uint8_t buttonQueueTail;
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t buttonsLatched;
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t buttonPressTime[ButtonCount];  // per P1 bit
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t buttonLatencyLast, buttonLatencyMax;
+
+void am_gpio_isr(void) {
+  uint64_t ui64Status;
+  am_hal_gpio_interrupt_status_get(false, &ui64Status);
+  am_hal_gpio_interrupt_clear(ui64Status);
+
+  // Every press harvests energy, let the JIT forecast learn from it
+  jit_button_event();
+
+  // All buttons of the interrupt, presses at the same time are one event
+  uint8_t buttons = 0;
+  for (uint32_t n = 0; n < ButtonCount; n++) {
+    if (ui64Status & ((uint64_t)0x1 << buttonPins[n])) {
+      buttons |= buttonBits[n];
+    }
+  }
+  if (buttons == 0) {
+    return;
+  }
+
+  uint8_t next = (buttonQueueHead + 1) % BUTTON_QUEUE_SIZE;
+  if (next == buttonQueueTail) {
+    // Full, add the buttons to the newest event instead of dropping them
+    uint8_t newest = (buttonQueueHead + BUTTON_QUEUE_SIZE - 1) %
+                     BUTTON_QUEUE_SIZE;
+    buttonQueue[newest].buttons |= buttons;
+    return;
+  }
+  buttonQueue[buttonQueueHead].buttons = buttons;
+  buttonQueue[buttonQueueHead].time = am_hal_stimer_counter_get();
+  buttonQueueHead = next;
+}
+
+/*
+ * A press keeps its button down for BUTTON_ACTIVE_PERIOD after its last edge,
+ * but is always seen by at least one sample. Runs with the interrupts
+ * disabled while the queue is read, the interrupt only adds to it.
+ */
+void buttonsSample(void) {
+  if (buttonQueueHead == buttonQueueTail && buttonsLatched == 0) {
+    return;
+  }
+
+  uint32_t now = am_hal_stimer_counter_get();
+  uint8_t fresh = 0;
+
+  uint32_t critical = am_hal_interrupt_master_disable();
+  while (buttonQueueTail != buttonQueueHead) {
+    ButtonEvent* event = &buttonQueue[buttonQueueTail];
+    for (uint32_t bit = 0; bit < ButtonCount; bit++) {
+      if (event->buttons & (1 << bit)) {
+        buttonPressTime[bit] = event->time;
+      }
+    }
+    fresh |= event->buttons;
+
+    buttonLatencyLast = now - event->time;
+    if (buttonLatencyLast > buttonLatencyMax) {
+      buttonLatencyMax = buttonLatencyLast;
+    }
+    buttonQueueTail = (buttonQueueTail + 1) % BUTTON_QUEUE_SIZE;
+  }
+  am_hal_interrupt_master_set(critical);
+
+  buttonsLatched |= fresh;
+  for (uint32_t bit = 0; bit < ButtonCount; bit++) {
+    if ((buttonsLatched & ~fresh & (1 << bit)) &&
+        (now - buttonPressTime[bit]) >= ButtonActiveTicks) {
+      buttonsLatched &= ~(1 << bit);
+    }
+  }
+
+  GB.key.code_btn = KEYCODE_BTN_NONE & ~(buttonsLatched & 0x0F);
+  GB.key.code_cursor = KEYCODE_CURSOR_NONE & ~(buttonsLatched >> 4);
+
+#if BUTTON_LATENCY_REPORT
+  if (fresh) {
+    am_util_stdio_printf("[buttons] latency: %u us (max %u us)\n",
+                         buttonsLatencyLast(), buttonsLatencyMax());
+  }
+#endif
+}
+
+uint32_t buttonsLatencyLast(void) {
+  return buttonLatencyLast / ButtonTicksPerUs;
+}
+
+uint32_t buttonsLatencyMax(void) { return buttonLatencyMax / ButtonTicksPerUs; }
+#else
 void debounceTimerInit();
 
 void am_gpio_isr(void) {
@@ -28,6 +159,9 @@ void am_gpio_isr(void) {
   am_hal_gpio_interrupt_status_get(false, &ui64Status);
   am_hal_gpio_interrupt_clear(ui64Status);
 
+  // Every press harvests energy, let the JIT forecast learn from it
+  jit_button_event();
+
   // A B
   if (ui64Status & BUTTON_A_MASK) {
     processPress(KEYCODE_BTN_A, AM_HAL_CTIMER_TIMERA);
@@ -74,6 +208,7 @@ void am_gpio_isr(void) {
     return;
   }
 }
+#endif
 
 const uint64_t GpioIntMask = BUTTON_A_MASK | BUTTON_B_MASK | BUTTON_UP_MASK |
                              BUTTON_DOWN_MASK | BUTTON_RIGHT_MASK |
@@ -97,7 +232,9 @@ void buttonsConfig() {
   am_hal_gpio_pinconfig(BUTTON_START, g_GpioIOConfig);
   am_hal_gpio_pinconfig(BUTTON_SELECT, g_GpioIOConfig);
 
+#if !BUTTON_EVENTS
   debounceTimerInit();
+#endif
 
   am_hal_gpio_interrupt_clear(GpioIntMask);
   am_hal_gpio_interrupt_enable(GpioIntMask);
@@ -106,6 +243,7 @@ void buttonsConfig() {
   am_hal_interrupt_master_enable();
 }
 
+#if !BUTTON_EVENTS
 #define DebounceTimerClkSource AM_HAL_CTIMER_HFRC_12KHZ
 #define BUTTON_NUM_PULSES_PERIOD ((BUTTON_ACTIVE_PERIOD * 12) - 1)
 
@@ -143,3 +281,4 @@ void am_ctimer_isr(void) {
     am_hal_ctimer_clear(DebounceTimer, AM_HAL_CTIMER_TIMERB);
   }
 }
+#endif
@@ -9,10 +9,20 @@
 #ifndef LIBS_BUTTONS_BUTTONS_H_
 #define LIBS_BUTTONS_BUTTONS_H_
 
+#include "emulator_settings.h"
 #include "gameboy_ub.h"
 
 void buttonsConfig();
 
+#if BUTTON_EVENTS
+// Updates GB.key from the presses since the last call, called by the emulator
+// when the game selects a row of the joypad (P1)
+void buttonsSample(void);
+
+// Time from a press to its first sample (in us), the last and the worst case
+uint32_t buttonsLatencyLast(void);
+uint32_t buttonsLatencyMax(void);
+#else
 #define DebounceTimer 7
 
 __attribute__((always_inline)) static inline void processPress(
@@ -24,5 +34,6 @@ __attribute__((always_inline)) static inline void processPress(
     am_hal_ctimer_start(DebounceTimer, timerSection);
   }
 }
+#endif
 
 #endif /* LIBS_BUTTONS_BUTTONS_H_ */
@@ -11,6 +11,12 @@
 #include "am_util_delay.h"
 #include "platform.h"
 
+#if CARTRIDGE_PIPELINE
+// Command queues for the non-blocking transfers, one per IOM
+CHECKPOINT_EXCLUDE_BSS uint32_t CartridgeAddressTxnBuffer[64];
+CHECKPOINT_EXCLUDE_BSS uint32_t CartridgeDataTxnBuffer[64];
+#endif
+
 CHECKPOINT_EXCLUDE_DATA
 am_hal_iom_config_t CartridgeConfigIOM = {
     .eInterfaceMode = AM_HAL_IOM_I2C_MODE,
@@ -20,6 +26,12 @@ am_hal_iom_config_t CartridgeConfigIOM = {
 void i2cWrite(CartridgeIomModules module, uint8_t deviceAddress,
               const uint8_t data);
 void i2cRead(CartridgeIomModules module, uint8_t deviceAddress, uint8_t* data);
+static void i2cWriteBurst(CartridgeIomModules module, uint8_t deviceAddress,
+                          const uint8_t* data, uint32_t length,
+                          void (*background)(void));
+static void i2cTransfer(CartridgeIomModules module,
+                        am_hal_iom_transfer_t* transaction,
+                        void (*background)(void));
 
 CHECKPOINT_EXCLUDE_BSS
 void* cartridgeAddressI2cHandle;
@@ -46,11 +58,20 @@ void cartridgeInterfaceConfig() {
 
   am_hal_iom_initialize(IomAddress, &cartridgeAddressI2cHandle);
   am_hal_iom_power_ctrl(cartridgeAddressI2cHandle, AM_HAL_SYSCTRL_WAKE, false);
+#if CARTRIDGE_PIPELINE
+  CartridgeConfigIOM.pNBTxnBuf = CartridgeAddressTxnBuffer;
+  CartridgeConfigIOM.ui32NBTxnBufLength =
+      sizeof(CartridgeAddressTxnBuffer) / 4;
+#endif
   am_hal_iom_configure(cartridgeAddressI2cHandle, &CartridgeConfigIOM);
   am_hal_iom_enable(cartridgeAddressI2cHandle);
 
   am_hal_iom_initialize(IomData, &cartridgeDataI2cHandle);
   am_hal_iom_power_ctrl(cartridgeDataI2cHandle, AM_HAL_SYSCTRL_WAKE, false);
+#if CARTRIDGE_PIPELINE
+  CartridgeConfigIOM.pNBTxnBuf = CartridgeDataTxnBuffer;
+  CartridgeConfigIOM.ui32NBTxnBufLength = sizeof(CartridgeDataTxnBuffer) / 4;
+#endif
   am_hal_iom_configure(cartridgeDataI2cHandle, &CartridgeConfigIOM);
   am_hal_iom_enable(cartridgeDataI2cHandle);
 
@@ -73,10 +94,20 @@ void cartridgeInterfaceWriteControl(CartridgeControlSignals state) {
   cartridgeControlState = state;
 }
 
-void cartridgeInterfaceWriteData(uint16_t address, uint8_t data) {
+/*
+ * Sets the address bus in a single transaction, RegDataB and RegDataA are
+ * adjacent and the SX1503 increments the register address after each byte.
+ */
+static void writeAddress(uint16_t address, void (*background)(void)) {
   uint16_t address_rev = __RBIT(address) >> 16;
-  i2cWrite(IomAddress, SX150X_RegDataA, address_rev);
-  i2cWrite(IomAddress, SX150X_RegDataB, address_rev >> 8);
+  uint8_t burst[2] __attribute__((aligned(4))) = {address_rev >> 8,
+                                                   address_rev & 0xFF};
+  i2cWriteBurst(IomAddress, SX150X_RegDataB, burst, sizeof(burst),
+                background);
+}
+
+void cartridgeInterfaceWriteData(uint16_t address, uint8_t data) {
+  writeAddress(address, NULL);
 
   uint8_t dataRaw = __RBIT(data) >> 24;
   i2cWrite(IomData, SX150X_RegDataA, dataRaw);
@@ -97,11 +128,60 @@ void cartridgeInterfaceWriteData(uint16_t address, uint8_t data) {
   i2cWrite(IomData, SX150X_RegDirA, 0xff);  // set data bus to input (default)
 }
 
+/*
+ * Writes a block to consecutive addresses (the cartridge RAM). The data bus
+ * stays an output for the whole block and the write strobe goes out together
+ * with the data, RegDataB and RegDataA are adjacent. The RAM takes the data
+ * on the rising edge of WRn, three transactions per byte instead of six.
+ */
+void cartridgeInterfaceWriteBlock(uint16_t address, const uint8_t* data,
+                                  uint32_t length) {
+  CartridgeControlSignals signalCpy = cartridgeControlState;
+  i2cWrite(IomData, SX150X_RegDirA, 0x00);  // set data bus to output
+
+  for (uint32_t i = 0; i < length; i++) {
+    writeAddress(address + i, NULL);
+
+    signalCpy.CartridgeCLK = true;
+    signalCpy.CartridgeCS = false;
+    signalCpy.CartridgeWRn = false;  // write operation
+    signalCpy.CartridgeRDn = true;
+    uint8_t burst[2] __attribute__((aligned(4))) = {
+        signalCpy.asUint8_t, __RBIT(data[i]) >> 24};
+    i2cWriteBurst(IomData, SX150X_RegDataB, burst, sizeof(burst), NULL);
+
+    signalCpy.CartridgeCLK = false;
+    signalCpy.CartridgeCS = true;
+    signalCpy.CartridgeWRn = true;
+    cartridgeInterfaceWriteControl(signalCpy);
+  }
+
+  i2cWrite(IomData, SX150X_RegDirA, 0xff);  // set data bus to input (default)
+}
+
 void cartridgeInterfaceReadData(uint16_t address, uint8_t* data) {
-  uint16_t address_rev = __RBIT(address) >> 16;
-  i2cWrite(IomAddress, SX150X_RegDataA, address_rev);
-  i2cWrite(IomAddress, SX150X_RegDataB, address_rev >> 8);
+  cartridgeInterfaceReadBlock(address, data, 1);
+}
+
+/*
+ * The read signals stay asserted for the whole block, the cartridge memory is
+ * asynchronous so only the address changes between bytes. That leaves two
+ * transactions per byte, an address burst and the data read.
+ */
+void cartridgeInterfaceReadBlock(uint16_t address, uint8_t* data,
+                                 uint32_t length) {
+  cartridgeInterfaceReadBlockOverlapped(address, data, length, NULL);
+}
 
+/*
+ * Same as cartridgeInterfaceReadBlock(), but background is called repeatedly
+ * while the IOMs are busy with the transfers (requires CARTRIDGE_PIPELINE).
+ * It should only do short steps of work, the next transfer is started once
+ * it returns.
+ */
+void cartridgeInterfaceReadBlockOverlapped(uint16_t address, uint8_t* data,
+                                           uint32_t length,
+                                           void (*background)(void)) {
   CartridgeControlSignals signalCpy = cartridgeControlState;
   signalCpy.CartridgeCLK = true;
   signalCpy.CartridgeCS = false;
@@ -109,9 +189,20 @@ void cartridgeInterfaceReadData(uint16_t address, uint8_t* data) {
   signalCpy.CartridgeWRn = true;
   cartridgeInterfaceWriteControl(signalCpy);
 
-  uint8_t dataRaw;
-  i2cRead(IomData, SX150X_RegDataA, &dataRaw);
-  *data = __RBIT(dataRaw) >> 24;
+  for (uint32_t i = 0; i < length; i++) {
+    writeAddress(address + i, background);
+
+    uint8_t dataRaw;
+    am_hal_iom_transfer_t Transaction = {};
+    Transaction.ui32InstrLen = 1;
+    Transaction.ui32Instr = SX150X_RegDataA;
+    Transaction.eDirection = AM_HAL_IOM_RX;
+    Transaction.ui32NumBytes = 1;
+    Transaction.pui32RxBuffer = (uint32_t*)&dataRaw;
+    Transaction.uPeerInfo.ui32I2CDevAddr = SX150X_Address;
+    i2cTransfer(IomData, &Transaction, background);
+    data[i] = __RBIT(dataRaw) >> 24;
+  }
 
   signalCpy.CartridgeCLK = false;
   signalCpy.CartridgeCS = true;
@@ -137,6 +228,22 @@ void i2cWrite(CartridgeIomModules module, uint8_t deviceAddress,
   }
 }
 
+// Writes consecutive registers starting at deviceAddress
+static void i2cWriteBurst(CartridgeIomModules module, uint8_t deviceAddress,
+                          const uint8_t* data, uint32_t length,
+                          void (*background)(void)) {
+  am_hal_iom_transfer_t Transaction = {};
+
+  Transaction.ui32InstrLen = 1;
+  Transaction.ui32Instr = deviceAddress;
+  Transaction.eDirection = AM_HAL_IOM_TX;
+  Transaction.ui32NumBytes = length;
+  Transaction.pui32TxBuffer = (uint32_t*)data;
+  Transaction.uPeerInfo.ui32I2CDevAddr = SX150X_Address;
+
+  i2cTransfer(module, &Transaction, background);
+}
+
 void i2cRead(CartridgeIomModules module, uint8_t deviceAddress, uint8_t* data) {
   am_hal_iom_transfer_t Transaction = {};
 
@@ -153,3 +260,45 @@ void i2cRead(CartridgeIomModules module, uint8_t deviceAddress, uint8_t* data) {
     am_hal_iom_blocking_transfer(cartridgeDataI2cHandle, &Transaction);
   }
 }
+
+#if CARTRIDGE_PIPELINE
+static void transferDone(void* ctxt, uint32_t status) {
+  *(volatile bool*)ctxt = true;
+}
+
+// The IOM interrupts stay disabled in the NVIC, the transfers are polled
+static void serviceIom(void* handle) {
+  uint32_t status;
+
+  if (!am_hal_iom_interrupt_status_get(handle, true, &status)) {
+    if (status) {
+      am_hal_iom_interrupt_clear(handle, status);
+      am_hal_iom_interrupt_service(handle, status);
+    }
+  }
+}
+#endif
+
+// Blocking transfer, or a non-blocking one that runs background until done
+static void i2cTransfer(CartridgeIomModules module,
+                        am_hal_iom_transfer_t* transaction,
+                        void (*background)(void)) {
+  void* handle = (module == IomAddress) ? cartridgeAddressI2cHandle
+                                        : cartridgeDataI2cHandle;
+
+#if CARTRIDGE_PIPELINE
+  if (background) {
+    volatile bool done = false;
+    if (am_hal_iom_nonblocking_transfer(handle, transaction, transferDone,
+                                        (void*)&done) ==
+        AM_HAL_STATUS_SUCCESS) {
+      while (!done) {
+        background();
+        serviceIom(handle);
+      }
+      return;
+    }
+  }
+#endif
+  am_hal_iom_blocking_transfer(handle, transaction);
+}
@@ -93,5 +93,12 @@ void cartridgeInterfaceConfig();
 void cartridgeInterfaceWriteControl(CartridgeControlSignals state);
 void cartridgeInterfaceWriteData(uint16_t address, uint8_t data);
 void cartridgeInterfaceReadData(uint16_t address, uint8_t* data);
+void cartridgeInterfaceReadBlock(uint16_t address, uint8_t* data,
+                                 uint32_t length);
+void cartridgeInterfaceWriteBlock(uint16_t address, const uint8_t* data,
+                                  uint32_t length);
+void cartridgeInterfaceReadBlockOverlapped(uint16_t address, uint8_t* data,
+                                           uint32_t length,
+                                           void (*background)(void));
 
 #endif /* LIBS_CARTRIDGE_CARTRIDGE_H_ */
@@ -0,0 +1,261 @@
+/*
+ * library.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "library.h"
+
+#include "platform.h"
+#include "reader.h"
+#include "string.h"
+
+#define RomLibraryMagic 0x47424C31  // "GBL1"
+#define RomLibraryErased 0xFFFFFFFF
+#define RomLibraryAll 0xFFFFFFFF  // keep every entry
+
+_Static_assert(sizeof(RomLibraryDirectory) <= AM_HAL_FLASH_PAGE_SIZE,
+               "The directory has to fit in a flash page");
+
+// The directory is built in here when a page has to be written again
+CHECKPOINT_EXCLUDE_BSS
+static RomLibraryDirectory directoryBuffer __attribute__((aligned(4)));
+
+static const RomLibraryDirectory* directoryPage(uint8_t page) {
+  return (const RomLibraryDirectory*)(RomLibraryStart +
+                                      page * AM_HAL_FLASH_PAGE_SIZE);
+}
+
+static uint8_t pageValid(const RomLibraryDirectory* page) {
+  return page->generation != RomLibraryErased &&
+         page->generationCheck == ~page->generation;
+}
+
+/*
+ * A rewrite goes to the other page and only makes it valid once complete, a
+ * power failure in between leaves the old directory in use. Until the first
+ * rewrite neither page is valid and the first one is used.
+ */
+static uint8_t activePage(void) {
+  const RomLibraryDirectory* first = directoryPage(0);
+  const RomLibraryDirectory* second = directoryPage(1);
+
+  if (!pageValid(second)) {
+    return 0;
+  }
+  if (!pageValid(first) || second->generation > first->generation) {
+    return 1;
+  }
+  return 0;
+}
+
+#define directory directoryPage(activePage())
+
+static uint8_t entryValid(uint8_t index) {
+  return directory->entry[index].magic == RomLibraryMagic;
+}
+
+static uint8_t entryErased(uint8_t index) {
+  const uint32_t* word = (const uint32_t*)&directory->entry[index];
+  for (uint32_t n = 0; n < sizeof(RomLibraryEntry) / 4; n++) {
+    if (word[n] != RomLibraryErased) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void programWords(const void* source, const void* destination,
+                         uint32_t words) {
+  am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY, (uint32_t*)source,
+                            (uint32_t*)destination, words);
+}
+
+/*
+ * Writes the directory to the other page with the entries in keep (a bit per
+ * entry), the selection log is restarted with selected.
+ */
+static void rewriteDirectory(uint32_t keep, uint8_t selected) {
+  uint8_t page = activePage();
+  const RomLibraryDirectory* active = directoryPage(page);
+  const RomLibraryDirectory* target =
+      directoryPage((page + 1) % RomLibraryPages);
+
+  memset(&directoryBuffer, 0xFF, sizeof(directoryBuffer));
+  for (uint8_t n = 0; n < RomLibraryEntries; n++) {
+    if ((keep & (1 << n)) && entryValid(n)) {
+      directoryBuffer.entry[n] = active->entry[n];
+    }
+  }
+  if (selected != RomLibraryNone && (keep & (1 << selected))) {
+    directoryBuffer.selected[0] = selected;
+  }
+
+  directoryBuffer.generation = pageValid(active) ? active->generation + 1 : 0;
+  directoryBuffer.generationCheck = ~directoryBuffer.generation;
+
+  am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
+                          AM_HAL_FLASH_ADDR2INST((uintptr_t)target),
+                          AM_HAL_FLASH_ADDR2PAGE((uintptr_t)target));
+  // The check goes last, it makes the page the directory
+  programWords(&directoryBuffer, target, (sizeof(directoryBuffer) / 4) - 1);
+  programWords(&directoryBuffer.generationCheck, &target->generationCheck, 1);
+}
+
+uint8_t romLibrarySelected(void) {
+  uint32_t selected = RomLibraryNone;
+
+  for (uint32_t n = 0; n < RomLibrarySelectLog; n++) {
+    if (directory->selected[n] == RomLibraryErased) {
+      break;
+    }
+    selected = directory->selected[n];
+  }
+
+  if (selected >= RomLibraryEntries || !entryValid(selected)) {
+    return RomLibraryNone;
+  }
+  return selected;
+}
+
+// Start of the selected ROM, a ROM dumped before the library is at the start
+uintptr_t romLibraryBase(void) {
+  uint8_t selected = romLibrarySelected();
+  if (selected == RomLibraryNone) {
+    return GameRomStart;
+  }
+  return GameRomStart + directory->entry[selected].offset;
+}
+
+uint8_t romLibraryFind(const uint8_t* title, uint16_t checksum,
+                       uint8_t headerChecksum) {
+  for (uint8_t n = 0; n < RomLibraryEntries; n++) {
+    if (entryValid(n) && memcmp(directory->entry[n].title, title, 16) == 0 &&
+        directory->entry[n].checksum == checksum &&
+        directory->entry[n].headerChecksum == headerChecksum) {
+      return n;
+    }
+  }
+  return RomLibraryNone;
+}
+
+const RomLibraryEntry* romLibraryEntry(uint8_t index) {
+  return &directory->entry[index];
+}
+
+void romLibrarySelect(uint8_t index) {
+  if (index == romLibrarySelected()) {
+    return;
+  }
+
+  for (uint32_t n = 0; n < RomLibrarySelectLog; n++) {
+    if (directory->selected[n] == RomLibraryErased) {
+      uint32_t selected = index;
+      programWords(&selected, &directory->selected[n], 1);
+      return;
+    }
+  }
+
+  // The log is full
+  rewriteDirectory(RomLibraryAll, index);
+}
+
+// Selects the next ROM of the library (in entry order), returns its index
+uint8_t romLibrarySelectNext(void) {
+  uint8_t selected = romLibrarySelected();
+  uint8_t index = (selected == RomLibraryNone) ? 0 : selected + 1;
+
+  for (uint8_t n = 0; n < RomLibraryEntries; n++, index++) {
+    index %= RomLibraryEntries;
+    if (entryValid(index)) {
+      romLibrarySelect(index);
+      return index;
+    }
+  }
+  return RomLibraryNone;
+}
+
+static uint8_t newestEntry(void) {
+  uint8_t newest = RomLibraryNone;
+  for (uint8_t n = 0; n < RomLibraryEntries; n++) {
+    if (entryValid(n) && (newest == RomLibraryNone ||
+                          directory->entry[n].sequence >
+                              directory->entry[newest].sequence)) {
+      newest = n;
+    }
+  }
+  return newest;
+}
+
+/*
+ * Returns the offset for a new ROM of size bytes, right after the most
+ * recently added one or from the start when it does not fit anymore. The ROMs
+ * that are in the way are removed from the directory.
+ */
+uint32_t romLibraryAllocate(uint32_t size) {
+  uint8_t newest = newestEntry();
+  uint32_t offset = 0;
+
+  if (newest != RomLibraryNone) {
+    offset = directory->entry[newest].offset + directory->entry[newest].size;
+  }
+  if (offset + size > (GameRomEnd - GameRomStart)) {
+    offset = 0;
+  }
+
+  uint32_t keep = RomLibraryAll;
+  for (uint8_t n = 0; n < RomLibraryEntries; n++) {
+    const RomLibraryEntry* entry = &directory->entry[n];
+    if (entryValid(n) && entry->offset < offset + size &&
+        offset < entry->offset + entry->size) {
+      keep &= ~(1 << n);
+    }
+  }
+  if (keep != RomLibraryAll) {
+    rewriteDirectory(keep, romLibrarySelected());
+  }
+  return offset;
+}
+
+// Adds a completely dumped ROM (offset from romLibraryAllocate) and selects it
+void romLibraryAdd(RomLibraryEntry* entry) {
+  uint8_t index = romLibraryFind(entry->title, entry->checksum,
+                                 entry->headerChecksum);
+  if (index != RomLibraryNone) {
+    romLibrarySelect(index);
+    return;
+  }
+
+  uint8_t newest = newestEntry();
+  entry->magic = RomLibraryMagic;
+  entry->sequence =
+      (newest == RomLibraryNone) ? 0 : directory->entry[newest].sequence + 1;
+
+  for (index = 0; index < RomLibraryEntries; index++) {
+    if (!entryValid(index)) {
+      break;
+    }
+  }
+
+  if (index == RomLibraryEntries) {
+    // The directory is full, the oldest ROM makes room
+    index = 0;
+    for (uint8_t n = 1; n < RomLibraryEntries; n++) {
+      if (directory->entry[n].sequence < directory->entry[index].sequence) {
+        index = n;
+      }
+    }
+    rewriteDirectory(~(1UL << index), romLibrarySelected());
+  } else if (!entryErased(index)) {
+    // Left over from an add that was cut off by a power failure
+    rewriteDirectory(~(1UL << index), romLibrarySelected());
+  }
+
+  // The magic goes last, it makes the entry valid
+  programWords(&entry->sequence, &directory->entry[index].sequence,
+               (sizeof(RomLibraryEntry) / 4) - 1);
+  programWords(&entry->magic, &directory->entry[index].magic, 1);
+  romLibrarySelect(index);
+}
@@ -0,0 +1,58 @@
+/*
+ * library.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef LIBS_CARTRIDGE_LIBRARY_H_
+#define LIBS_CARTRIDGE_LIBRARY_H_
+
+#include "am_mcu_apollo.h"
+#include "emulator_settings.h"
+
+extern uint32_t _s_gb_library;
+
+// Directory of the ROMs in GBMEM, two flash pages that are written in turns
+#define RomLibraryStart ((uintptr_t)(&_s_gb_library))
+#define RomLibraryPages 2
+
+#define RomLibraryEntries 8
+#define RomLibrarySelectLog 64  // selections before the page is rewritten
+#define RomLibraryNone 0xFF
+
+typedef struct {
+  uint32_t magic;  // erased = free entry
+  uint32_t sequence;  // order in which the ROMs were added
+  uint8_t title[16];
+  uint32_t checksum;  // cartridge global checksum
+  uint32_t headerChecksum;
+  uint32_t offset;  // from GameRomStart
+  uint32_t size;
+  uint8_t cartridgeType;
+  uint8_t romSize;
+  uint8_t ramSize;
+  uint8_t reserved;
+} RomLibraryEntry;
+
+typedef struct {
+  RomLibraryEntry entry[RomLibraryEntries];
+  uint32_t selected[RomLibrarySelectLog];  // the last one written counts
+  uint32_t generation;  // the page with the newest one is the directory
+  uint32_t generationCheck;  // ~generation, written last
+} RomLibraryDirectory;
+
+uint8_t romLibrarySelected(void);
+uintptr_t romLibraryBase(void);
+uint8_t romLibraryFind(const uint8_t* title, uint16_t checksum,
+                       uint8_t headerChecksum);
+const RomLibraryEntry* romLibraryEntry(uint8_t index);
+
+void romLibrarySelect(uint8_t index);
+uint8_t romLibrarySelectNext(void);
+
+uint32_t romLibraryAllocate(uint32_t size);
+void romLibraryAdd(RomLibraryEntry* entry);
+
+#endif /* LIBS_CARTRIDGE_LIBRARY_H_ */
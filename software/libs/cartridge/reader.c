@@ -9,6 +9,7 @@
 #include "reader.h"
 
 #include "am_util.h"
+#include "library.h"
 #include "platform.h"
 #include "string.h"
 
@@ -20,6 +21,10 @@ CHECKPOINT_EXCLUDE_BSS
 uint8_t cartridgeType;
 CHECKPOINT_EXCLUDE_BSS
 uint8_t numRomBanks;
+CHECKPOINT_EXCLUDE_BSS
+uint16_t romChecksum;
+CHECKPOINT_EXCLUDE_BSS
+uint8_t romHeaderChecksum;
 
 // Save these through power failure
 uint8_t romTitle[17];
@@ -27,8 +32,34 @@ uint32_t cartridgeSizeBytes = 0;
 
 uint32_t cartridgeGetSizeBytes() { return cartridgeSizeBytes; }
 
+// Flash address of the ROM that is dumped or played, 0 until known
+CHECKPOINT_EXCLUDE_BSS
+uintptr_t romBase;
+
+uintptr_t cartridgeRomStart() {
+  if (romBase) {
+    return romBase;
+  }
+#if ROM_LIBRARY
+  return romLibraryBase();
+#else
+  return GameRomStart;
+#endif
+}
+
+// Set once the cartridge interface is configured in this power cycle
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t cartridgeConnected;
+
+static void cartridgeInterfaceConnect() {
+  if (!cartridgeConnected) {
+    cartridgeInterfaceConfig();
+    cartridgeConnected = 1;
+  }
+}
+
 void cartridgeConfig() {
-  cartridgeInterfaceConfig();
+  cartridgeInterfaceConnect();
 
   if (cartridgeSanityCheck()) {
     am_util_stdio_printf("Error reading cartridge!\n");
@@ -46,9 +77,23 @@ uint8_t checkSavedCartridge(const uint8_t* startOfRom) {
     return 0;
   }
 
+  // Checksum over the header from the title up to the version number
+  uint8_t headerChecksum = 0;
+  for (uint16_t i = CartridgeTitleAddress; i < CartridgeHeaderChecksumAddress;
+       i++) {
+    headerChecksum = headerChecksum - startOfRom[i] - 1;
+  }
+  if (headerChecksum != startOfRom[CartridgeHeaderChecksumAddress]) {
+    return 0;
+  }
+
   memcpy(romTitle, &startOfRom[CartridgeTitleAddress], 0x10);
   romTitle[16] = '\0';
 
+  if (startOfRom[CartridgeRomSizeAddress] > CartridgeRomSizeMax) {
+    return 0;
+  }
+
   cartridgeType = startOfRom[CartridgeTypeAddress];
   romSize = startOfRom[CartridgeRomSizeAddress];
   ramSize = startOfRom[CartridgeRamSizeAddress];
@@ -64,11 +109,8 @@ uint8_t checkSavedCartridge(const uint8_t* startOfRom) {
 
 uint8_t cartridgeSanityCheck() {
   uint8_t startOfCartridge[2] = {};
-  for (uint16_t address = CartridgeStart; address < CartridgeStart + 2;
-       address++) {
-    cartridgeInterfaceReadData(address,
-                               &startOfCartridge[address - CartridgeStart]);
-  }
+  cartridgeInterfaceReadBlock(CartridgeStart, startOfCartridge,
+                              sizeof(startOfCartridge));
 
   if (startOfCartridge[0] != 0x00 || startOfCartridge[1] != 0xC3) {
     return 1;  // error
@@ -77,19 +119,23 @@ uint8_t cartridgeSanityCheck() {
 }
 
 void cartridgeReadInfo() {
-  for (uint16_t address = CartridgeTitleAddress;
-       address < CartridgeTitleAddress + 0x10; address++) {
-    cartridgeInterfaceReadData(address,
-                               &romTitle[address - CartridgeTitleAddress]);
-  }
+  cartridgeInterfaceReadBlock(CartridgeTitleAddress, romTitle, 0x10);
   romTitle[16] = '\0';
 
   cartridgeInterfaceReadData(CartridgeTypeAddress, &cartridgeType);
   cartridgeInterfaceReadData(CartridgeRomSizeAddress, &romSize);
   cartridgeInterfaceReadData(CartridgeRamSizeAddress, &ramSize);
 
+  uint8_t checksum[3];
+  cartridgeInterfaceReadBlock(CartridgeHeaderChecksumAddress, checksum,
+                              sizeof(checksum));
+  romHeaderChecksum = checksum[0];
+  romChecksum = (checksum[1] << 8) | checksum[2];
+
   numRomBanks = 2;  // 32K default ROM size
-  if (romSize >= 1) {
+  if (romSize > CartridgeRomSizeMax) {
+    numRomBanks = 0;  // not read, see romSizeSupported()
+  } else if (romSize >= 1) {
     numRomBanks = 2 << romSize;
   }
 
@@ -100,6 +146,20 @@ void cartridgeReadInfo() {
                        GameRomStart, GameRomEnd);
 }
 
+/*
+ * The 4MB and 8MB MBC5 ROMs (256 banks and more) are not dumped, their bank
+ * numbers do not fit and they are larger than GBMEM anyway.
+ */
+static uint8_t romSizeSupported(void) {
+  if (romSize > CartridgeRomSizeMax) {
+    am_util_stdio_printf("ROM to big, %d KB is not supported ... \n",
+                         32 << romSize);
+    cartridgeSizeBytes = 0;
+    return 0;
+  }
+  return 1;
+}
+
 void switchCartridgeRomBank(uint8_t bank) {
   if (cartridgeType >= 5) {  // For MBC 2
     cartridgeInterfaceWriteData(CartridgeRamBankRegisterAddress, bank);
@@ -110,49 +170,649 @@ void switchCartridgeRomBank(uint8_t bank) {
   }
 }
 
+// RAM size code of the header in bytes
+uint32_t cartridgeRamSizeBytes(uint8_t ramSizeCode) {
+  static const uint32_t ramSizes[] = {0, 0x800, 0x2000, 0x8000, 0x20000,
+                                      0x10000};
+
+  if (ramSizeCode >= sizeof(ramSizes) / sizeof(ramSizes[0])) {
+    return 0;
+  }
+  return ramSizes[ramSizeCode];
+}
+
+#if EXTERNAL_RAM
+/*
+ * Configures the cartridge interface (once per power cycle) and checks that
+ * the inserted cartridge is the one of the ROM that is played.
+ */
+uint8_t cartridgeConnect() {
+  const uint8_t* rom = (const uint8_t*)cartridgeRomStart();
+  uint8_t checksum[3];
+
+  cartridgeInterfaceConnect();
+  if (cartridgeSanityCheck()) {
+    return 0;
+  }
+
+  cartridgeInterfaceReadBlock(CartridgeHeaderChecksumAddress, checksum,
+                              sizeof(checksum));
+  return memcmp(checksum, &rom[CartridgeHeaderChecksumAddress],
+                sizeof(checksum)) == 0;
+}
+
+// Enables the RAM and maps bank at 0xA000 (MBC1 mode 1)
+static void selectCartridgeRamBank(uint8_t bank) {
+  cartridgeInterfaceWriteData(CartridgeRamEnableAddress, CartridgeRamEnable);
+  cartridgeInterfaceWriteData(CartridgeModeSelectAddress, 1);
+  cartridgeInterfaceWriteData(CartridgeRamBankAddress, bank);
+}
+
+// Protects the RAM again and restores the ROM banking mode
+static void disableCartridgeRam() {
+  cartridgeInterfaceWriteData(CartridgeModeSelectAddress, 0);
+  cartridgeInterfaceWriteData(CartridgeRamBankAddress, 0);
+  cartridgeInterfaceWriteData(CartridgeRamEnableAddress, 0x00);
+}
+
+// Reads length bytes of the cartridge RAM at offset (over the banks)
+void cartridgeReadRam(uint32_t offset, uint8_t* data, uint32_t length) {
+  while (length) {
+    uint32_t bankOffset = offset % CartridgeRamBankSize;
+    uint32_t chunk = CartridgeRamBankSize - bankOffset;
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    selectCartridgeRamBank(offset / CartridgeRamBankSize);
+    cartridgeInterfaceReadBlock(CartridgeRamStart + bankOffset, data, chunk);
+    offset += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+  disableCartridgeRam();
+}
+
+/*
+ * Writes length bytes to the cartridge RAM at offset, returns 0 when the
+ * interface was lost on the way (a restore in between).
+ */
+uint8_t cartridgeWriteRam(uint32_t offset, const uint8_t* data,
+                          uint32_t length) {
+  while (length) {
+    uint32_t bankOffset = offset % CartridgeRamBankSize;
+    uint32_t chunk = CartridgeRamBankSize - bankOffset;
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    selectCartridgeRamBank(offset / CartridgeRamBankSize);
+    cartridgeInterfaceWriteBlock(CartridgeRamStart + bankOffset, data, chunk);
+    offset += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+  disableCartridgeRam();
+  return cartridgeConnected;
+}
+#endif
+
+#if CARTRIDGE_PIPELINE
+// One page is read from the cartridge while the other one is programmed
+CHECKPOINT_EXCLUDE_BSS
+uint8_t flashBuffer[2][AM_HAL_FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+#else
 CHECKPOINT_EXCLUDE_BSS
 uint8_t flashBuffer[AM_HAL_FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+#endif
+
+#if CARTRIDGE_RESUME
+#define DumpRecordMagic 0x47424434  // "GBD4"
+#define DumpRecordErased 0xFFFFFFFF
+#define DumpRecordLazy 0x4C415A59  // "LAZY", cleared to 0 when given up
+
+/*
+ * Progress of the last dump, kept in its own flash page. The CRC of a ROM page
+ * is programmed once the page is in flash, an erased entry marks a page that
+ * still has to be read. The bank follows from the page index.
+ */
+typedef struct {
+  uint32_t magic;
+  uint8_t title[16];
+  uint32_t checksum;  // cartridge global checksum
+  uint32_t headerChecksum;
+  uint32_t numRomBanks;
+  uint32_t offset;  // of the ROM from GameRomStart
+  uint32_t lazy;  // DumpRecordLazy when the banks are read on first access
+  uint32_t pageCrc[];
+} CartridgeDumpRecord;
+
+#define dumpRecord ((const CartridgeDumpRecord*)GameDumpRecordStart)
+
+#if CARTRIDGE_LAZY
+// Set when the banks of the ROM are read on their first access
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t romLazy;
+#define dumpRecordMode() (romLazy ? DumpRecordLazy : 0)
+#else
+#define dumpRecordMode() 0
+#endif
+
+static uint32_t dumpCrc(uintptr_t address) {
+  uint32_t crc = 0;
+  am_hal_crc32(address, AM_HAL_FLASH_PAGE_SIZE, &crc);
+  // The erased value is reserved for missing pages
+  return (crc == DumpRecordErased) ? ~DumpRecordErased : crc;
+}
+
+static uint8_t dumpRecordMatches() {
+  return dumpRecord->magic == DumpRecordMagic &&
+         memcmp(dumpRecord->title, romTitle, 16) == 0 &&
+         dumpRecord->checksum == romChecksum &&
+         dumpRecord->headerChecksum == romHeaderChecksum &&
+         dumpRecord->numRomBanks == numRomBanks;
+}
+
+// A lazy dump is completed while playing, it is not resumed at boot
+uint8_t cartridgeDumpPending() {
+  if (dumpRecord->magic != DumpRecordMagic ||
+      dumpRecord->lazy == DumpRecordLazy) {
+    return 0;
+  }
+
+  uint32_t pages =
+      dumpRecord->numRomBanks * CartridgeRomBankSize / AM_HAL_FLASH_PAGE_SIZE;
+  for (uint32_t page = 0; page < pages; page++) {
+    if (dumpRecord->pageCrc[page] == DumpRecordErased) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Only resumes a cut-off dump when a cartridge is inserted, the dump record is
+ * kept for a later boot otherwise.
+ */
+uint8_t cartridgeResumeAvailable() {
+  if (!cartridgeDumpPending()) {
+    return 0;
+  }
+
+  cartridgeInterfaceConnect();
+  if (cartridgeSanityCheck()) {
+    am_util_stdio_printf("Cartridge dump incomplete, insert the cartridge\n");
+    return 0;
+  }
+  return 1;
+}
+
+static void dumpRecordPage(uint32_t page, const uint8_t* data) {
+  uint32_t crc = dumpCrc((uintptr_t)data);
+  am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY, &crc,
+                            (uint32_t*)&dumpRecord->pageCrc[page], 1);
+}
+
+static uint8_t dumpPagesPresent(uint32_t page, uint32_t count) {
+  for (; count; count--, page++) {
+    if (dumpRecord->pageCrc[page] == DumpRecordErased) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+#if CARTRIDGE_VERIFY_SAMPLES
+static void readRomPage(uint32_t page, uint8_t* data) {
+  uint32_t offset = page * AM_HAL_FLASH_PAGE_SIZE;
+  uint8_t romBank = offset / CartridgeRomBankSize;
+  uint16_t address = offset % CartridgeRomBankSize;
+
+  if (romBank) {
+    switchCartridgeRomBank(romBank);
+    address += CartridgeRamBankAddress;
+  }
+  cartridgeInterfaceReadBlock(address, data, AM_HAL_FLASH_PAGE_SIZE);
+}
+
+/*
+ * The header only names the cartridge, so a few of the recorded pages spread
+ * over the ROM are read again and compared with their CRC. Returns the number
+ * of pages that differ.
+ */
+static uint32_t dumpRecordSample(uint32_t pages, uint32_t* differ) {
+  uint8_t* buffer = (uint8_t*)flashBuffer;
+  uint32_t count = 0;
+
+  for (uint32_t n = 0; n < CARTRIDGE_VERIFY_SAMPLES; n++) {
+    uint32_t page = 0;
+    if (CARTRIDGE_VERIFY_SAMPLES > 1) {
+      page = n * (pages - 1) / (CARTRIDGE_VERIFY_SAMPLES - 1);
+    }
+    if (!dumpPagesPresent(page, 1)) {
+      continue;
+    }
+
+    readRomPage(page, buffer);
+    if (dumpCrc((uintptr_t)buffer) != dumpRecord->pageCrc[page]) {
+      differ[count++] = page;
+    }
+  }
+
+  if (count) {
+    am_util_stdio_printf("  ... %d sampled pages differ from flash.\n", count);
+  }
+  return count;
+}
+#endif
+
+/*
+ * Checks the recorded pages against their CRC and returns the first page that
+ * is not in flash. The record is written again when it belongs to another
+ * cartridge or when a page failed the check.
+ */
+static uint32_t dumpRecordVerify(uint32_t pages) {
+  // The page buffer is not in use yet, build the new record in there
+  CartridgeDumpRecord* record = (CartridgeDumpRecord*)flashBuffer;
+  uint8_t rewrite = !dumpRecordMatches() ||
+                    dumpRecord->offset != romBase - GameRomStart ||
+                    dumpRecord->lazy != dumpRecordMode();
+  uint32_t first = pages;
+
+#if CARTRIDGE_VERIFY_SAMPLES
+  uint32_t differ[CARTRIDGE_VERIFY_SAMPLES];
+  uint32_t differCount = rewrite ? 0 : dumpRecordSample(pages, differ);
+#endif
+
+  for (uint32_t page = 0; page < pages; page++) {
+    uint32_t crc = rewrite ? DumpRecordErased : dumpRecord->pageCrc[page];
+    if (crc != DumpRecordErased &&
+        crc != dumpCrc(romBase + page * AM_HAL_FLASH_PAGE_SIZE)) {
+      crc = DumpRecordErased;
+      rewrite = 1;
+    }
+#if CARTRIDGE_VERIFY_SAMPLES
+    for (uint32_t n = 0; n < differCount; n++) {
+      if (differ[n] == page) {
+        crc = DumpRecordErased;
+        rewrite = 1;
+      }
+    }
+#endif
+    if (crc == DumpRecordErased && first == pages) {
+      first = page;
+    }
+    record->pageCrc[page] = crc;
+  }
+
+  if (rewrite) {
+    record->magic = DumpRecordMagic;
+    memcpy(record->title, romTitle, 16);
+    record->checksum = romChecksum;
+    record->headerChecksum = romHeaderChecksum;
+    record->numRomBanks = numRomBanks;
+    record->offset = romBase - GameRomStart;
+    record->lazy = dumpRecordMode();
+
+    am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
+                            AM_HAL_FLASH_ADDR2INST(GameDumpRecordStart),
+                            AM_HAL_FLASH_ADDR2PAGE(GameDumpRecordStart));
+    am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY, (uint32_t*)record,
+                              (uint32_t*)GameDumpRecordStart,
+                              (sizeof(CartridgeDumpRecord) / 4) + pages);
+  }
+  return first;
+}
+#endif
+
+#if CARTRIDGE_PIPELINE
+typedef struct {
+  const uint32_t* source;
+  uint32_t* destination;
+  uint32_t words;  // left to program
+#if CARTRIDGE_RESUME
+  const uint8_t* buffer;  // recorded once programmed
+  uint32_t page;
+#endif
+} FlashProgramJob;
+
+CHECKPOINT_EXCLUDE_BSS
+static FlashProgramJob programJob;
+
+// Programs the next few words of the pending page, runs between transfers
+static void programStep(void) {
+  uint32_t words = programJob.words;
+  if (words == 0) {
+    return;
+  }
+  if (words > CARTRIDGE_PROGRAM_CHUNK) {
+    words = CARTRIDGE_PROGRAM_CHUNK;
+  }
+
+  am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY,
+                            (uint32_t*)programJob.source,
+                            programJob.destination, words);
+  programJob.source += words;
+  programJob.destination += words;
+  programJob.words -= words;
+}
+
+static void programFinish(void) {
+  if (programJob.words) {
+    am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY,
+                              (uint32_t*)programJob.source,
+                              programJob.destination, programJob.words);
+    programJob.words = 0;
+  }
+#if CARTRIDGE_RESUME
+  if (programJob.buffer) {
+    dumpRecordPage(programJob.page, programJob.buffer);
+    programJob.buffer = NULL;
+  }
+#endif
+}
+
+static void eraseRomPages(uint32_t size) {
+  for (uint32_t offset = 0; offset < size; offset += AM_HAL_FLASH_PAGE_SIZE) {
+#if CARTRIDGE_RESUME
+    if (dumpPagesPresent(offset / AM_HAL_FLASH_PAGE_SIZE, 1)) {
+      continue;
+    }
+#endif
+    uint32_t flashRomAddress = offset + (uint32_t)romBase;
+    am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
+                            AM_HAL_FLASH_ADDR2INST(flashRomAddress),
+                            AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
+  }
+}
+#endif
+
+#if ROM_LIBRARY
+static void libraryAddRom(void) {
+  RomLibraryEntry entry __attribute__((aligned(4))) = {};
+  memcpy(entry.title, romTitle, 16);
+  entry.checksum = romChecksum;
+  entry.headerChecksum = romHeaderChecksum;
+  entry.offset = romBase - GameRomStart;
+  entry.size = numRomBanks * CartridgeRomBankSize;
+  entry.cartridgeType = cartridgeType;
+  entry.romSize = romSize;
+  entry.ramSize = ramSize;
+  romLibraryAdd(&entry);
+}
+
+/*
+ * Picks the flash region for the inserted cartridge. Returns 0 when the
+ * library holds it already, it is selected then and nothing has to be read.
+ * The ROM of the last dump is checked again as without the library.
+ */
+static uint8_t libraryPlaceRom(void) {
+  uint8_t index = romLibraryFind(romTitle, romChecksum, romHeaderChecksum);
+
+  if (index != RomLibraryNone) {
+    romBase = GameRomStart + romLibraryEntry(index)->offset;
+    if (dumpRecordMatches() &&
+        dumpRecord->offset == romLibraryEntry(index)->offset) {
+      return 1;
+    }
+    romLibrarySelect(index);
+    return 0;
+  }
+
+  if (dumpRecordMatches()) {
+    romBase = GameRomStart + dumpRecord->offset;
+  } else {
+    romBase = GameRomStart +
+              romLibraryAllocate(numRomBanks * CartridgeRomBankSize);
+  }
+  return 1;
+}
+#endif
 
 void cartridgeReadRom() {
   uint32_t flashRomSizeCounter = 0;
 
+  if (!romSizeSupported()) {
+    return;
+  }
+
+  romBase = GameRomStart;
+#if CARTRIDGE_LAZY
+  romLazy = 0;
+#endif
+#if ROM_LIBRARY
+  if (!libraryPlaceRom()) {
+    am_util_stdio_printf("  ... found in the ROM library.\n");
+    cartridgeSizeBytes = numRomBanks * CartridgeRomBankSize;
+    return;
+  }
+#endif
+
+#if CARTRIDGE_PIPELINE
+  if (numRomBanks * CartridgeRomBankSize > (GameRomEnd - romBase)) {
+    am_util_stdio_printf("ROM to big, increase ROM size ... \n");
+    return;
+  }
+#endif
+
+#if CARTRIDGE_RESUME
+  uint32_t resumePage = dumpRecordVerify(numRomBanks * CartridgeRomBankSize /
+                                         AM_HAL_FLASH_PAGE_SIZE);
+  if (resumePage) {
+    am_util_stdio_printf("  ... resuming at bank %d, page %d.\n",
+                         resumePage * AM_HAL_FLASH_PAGE_SIZE /
+                             CartridgeRomBankSize,
+                         resumePage);
+  }
+#endif
+
+#if CARTRIDGE_PIPELINE
+  // Erase up front, the programming then overlaps with the cartridge reads
+  am_util_stdio_printf("  ... erasing flash for %d banks.\n", numRomBanks);
+  eraseRomPages(numRomBanks * CartridgeRomBankSize);
+  uint8_t* buffer = flashBuffer[0];
+#endif
+
   for (uint8_t romBank = 1; romBank < numRomBanks; ++romBank) {
+#if CARTRIDGE_RESUME
+    // Skip the banks that are already in flash
+    uint32_t bankEnd = (romBank + 1) * CartridgeRomBankSize;
+    if (dumpPagesPresent(
+            flashRomSizeCounter / AM_HAL_FLASH_PAGE_SIZE,
+            (bankEnd - flashRomSizeCounter) / AM_HAL_FLASH_PAGE_SIZE)) {
+      flashRomSizeCounter = bankEnd;
+      continue;
+    }
+#endif
+
     switchCartridgeRomBank(romBank);
 
     uint16_t address = (romBank > 1) ? CartridgeRamBankAddress : 0x0000;
+#if !CARTRIDGE_PIPELINE
     if ((romBank * CartridgeRomBankSize + CartridgeRomBankSize - 1) >=
-        (GameRomEnd - GameRomStart)) {
+        (GameRomEnd - romBase)) {
       am_util_stdio_printf("ROM to big, increase ROM size ... \n");
       return;
     }
+#endif
 
-    uint32_t flashPageCounter = 0;
     for (; address < (CartridgeRomBankSize + CartridgeRamBankAddress);
-         ++address) {
-      cartridgeInterfaceReadData(
-          address, &flashBuffer[flashRomSizeCounter % AM_HAL_FLASH_PAGE_SIZE]);
-      flashRomSizeCounter++;
-      flashPageCounter++;
-
-      if (flashPageCounter >= AM_HAL_FLASH_PAGE_SIZE) {
-        uint32_t flashRomAddress = flashRomSizeCounter -
-                                   AM_HAL_FLASH_PAGE_SIZE +
-                                   (uint32_t)GameRomStart;
-        flashPageCounter = 0;
-        am_util_stdio_printf("  ... programming flash instance %d, page %d.\n",
-                             AM_HAL_FLASH_ADDR2INST(flashRomAddress),
-                             AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
-
-        am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
-                                AM_HAL_FLASH_ADDR2INST(flashRomAddress),
-                                AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
-
-        am_hal_flash_program_main(
-            AM_HAL_FLASH_PROGRAM_KEY, (uint32_t*)flashBuffer,
-            (uint32_t*)flashRomAddress, AM_HAL_FLASH_PAGE_SIZE / 4);
+         address += AM_HAL_FLASH_PAGE_SIZE) {
+#if CARTRIDGE_RESUME
+      if (dumpPagesPresent(flashRomSizeCounter / AM_HAL_FLASH_PAGE_SIZE, 1)) {
+        flashRomSizeCounter += AM_HAL_FLASH_PAGE_SIZE;
+        continue;
       }
+#endif
+
+#if CARTRIDGE_PIPELINE
+      cartridgeInterfaceReadBlockOverlapped(address, buffer,
+                                            AM_HAL_FLASH_PAGE_SIZE,
+                                            programStep);
+#else
+      cartridgeInterfaceReadBlock(address, flashBuffer,
+                                  AM_HAL_FLASH_PAGE_SIZE);
+#endif
+
+      uint32_t flashRomAddress = flashRomSizeCounter + (uint32_t)romBase;
+      flashRomSizeCounter += AM_HAL_FLASH_PAGE_SIZE;
+      am_util_stdio_printf("  ... programming flash instance %d, page %d.\n",
+                           AM_HAL_FLASH_ADDR2INST(flashRomAddress),
+                           AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
+
+#if CARTRIDGE_PIPELINE
+      // Normally done already, the cartridge bus is the slower side
+      programFinish();
+      programJob.source = (const uint32_t*)buffer;
+      programJob.destination = (uint32_t*)flashRomAddress;
+      programJob.words = AM_HAL_FLASH_PAGE_SIZE / 4;
+#if CARTRIDGE_RESUME
+      programJob.buffer = buffer;
+      programJob.page = flashRomSizeCounter / AM_HAL_FLASH_PAGE_SIZE - 1;
+#endif
+      buffer = (buffer == flashBuffer[0]) ? flashBuffer[1] : flashBuffer[0];
+#else
+      am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
+                              AM_HAL_FLASH_ADDR2INST(flashRomAddress),
+                              AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
+
+      am_hal_flash_program_main(
+          AM_HAL_FLASH_PROGRAM_KEY, (uint32_t*)flashBuffer,
+          (uint32_t*)flashRomAddress, AM_HAL_FLASH_PAGE_SIZE / 4);
+#if CARTRIDGE_RESUME
+      dumpRecordPage(flashRomSizeCounter / AM_HAL_FLASH_PAGE_SIZE - 1,
+                     flashBuffer);
+#endif
+#endif
     }
   }
 
+#if CARTRIDGE_PIPELINE
+  programFinish();
+#endif
+#if ROM_LIBRARY
+  libraryAddRom();
+#endif
+
   cartridgeSizeBytes = numRomBanks * CartridgeRomBankSize;
 }
+
+#if CARTRIDGE_LAZY
+// Copies pages from the mapped cartridge address into flash, except the ones
+// that are already there
+static void loadRomPages(uint16_t address, uint32_t page, uint32_t count) {
+  uint8_t* buffer = (uint8_t*)flashBuffer;
+
+  for (; count; count--, page++, address += AM_HAL_FLASH_PAGE_SIZE) {
+    if (dumpPagesPresent(page, 1)) {
+      continue;
+    }
+
+    uint32_t flashRomAddress =
+        page * AM_HAL_FLASH_PAGE_SIZE + (uint32_t)romBase;
+    cartridgeInterfaceReadBlock(address, buffer, AM_HAL_FLASH_PAGE_SIZE);
+    am_hal_flash_page_erase(AM_HAL_FLASH_PROGRAM_KEY,
+                            AM_HAL_FLASH_ADDR2INST(flashRomAddress),
+                            AM_HAL_FLASH_ADDR2PAGE(flashRomAddress));
+    am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY, (uint32_t*)buffer,
+                              (uint32_t*)flashRomAddress,
+                              AM_HAL_FLASH_PAGE_SIZE / 4);
+    dumpRecordPage(page, buffer);
+  }
+}
+
+/*
+ * Only reads bank 0, the other banks are read by cartridgeLoadRomBank() once
+ * the game maps them. The cartridge has to stay inserted while playing.
+ */
+void cartridgeReadRomLazy() {
+  uint32_t pagesPerBank = CartridgeRomBankSize / AM_HAL_FLASH_PAGE_SIZE;
+
+  if (!romSizeSupported()) {
+    return;
+  }
+
+  cartridgeSizeBytes = numRomBanks * CartridgeRomBankSize;
+  romBase = GameRomStart;
+#if ROM_LIBRARY
+  if (!libraryPlaceRom()) {
+    return;
+  }
+#endif
+
+  if (numRomBanks * CartridgeRomBankSize > (GameRomEnd - romBase)) {
+    am_util_stdio_printf("ROM to big, increase ROM size ... \n");
+    cartridgeSizeBytes = 0;
+    return;
+  }
+
+  romLazy = 1;
+  dumpRecordVerify(numRomBanks * pagesPerBank);
+  loadRomPages(0x0000, 0, pagesPerBank);
+}
+
+/*
+ * Continues a lazy dump that is not complete yet (every boot, also before a
+ * restore). Only flash is read, the cartridge is connected once a missing bank
+ * is mapped.
+ */
+void cartridgeLazyRestore() {
+  uint32_t pagesPerBank = CartridgeRomBankSize / AM_HAL_FLASH_PAGE_SIZE;
+
+  if (dumpRecord->magic != DumpRecordMagic ||
+      dumpRecord->lazy != DumpRecordLazy ||
+      dumpPagesPresent(0, dumpRecord->numRomBanks * pagesPerBank)) {
+    return;
+  }
+
+  romBase = GameRomStart + dumpRecord->offset;
+  // Bank 0 is in flash, it has the type and sizes
+  checkSavedCartridge((const uint8_t*)romBase);
+  numRomBanks = dumpRecord->numRomBanks;
+  romChecksum = dumpRecord->checksum;
+  romHeaderChecksum = dumpRecord->headerChecksum;
+  romLazy = 1;
+}
+
+// Gives up the lazy dump (another game is played), a later dump resumes it
+void cartridgeLazyCancel() {
+  if (dumpRecord->magic == DumpRecordMagic &&
+      dumpRecord->lazy == DumpRecordLazy) {
+    uint32_t lazy = 0;
+    am_hal_flash_program_main(AM_HAL_FLASH_PROGRAM_KEY, &lazy,
+                              (uint32_t*)&dumpRecord->lazy, 1);
+  }
+  romLazy = 0;
+}
+
+// Called by the emulator before a bank 1..n is read from flash
+void cartridgeLoadRomBank(uint8_t romBank) {
+  uint32_t pagesPerBank = CartridgeRomBankSize / AM_HAL_FLASH_PAGE_SIZE;
+  uint32_t page = romBank * pagesPerBank;
+
+  if (!romLazy || romBank == 0 || romBank >= numRomBanks ||
+      dumpPagesPresent(page, pagesPerBank)) {
+    return;
+  }
+
+  cartridgeInterfaceConnect();
+  if (cartridgeSanityCheck()) {
+    am_util_stdio_printf("ROM bank %d not in flash, insert the cartridge!\n",
+                         romBank);
+    while (1) {
+      ;
+    }
+  }
+
+  switchCartridgeRomBank(romBank);
+  loadRomPages(CartridgeRamBankAddress, page, pagesPerBank);
+#if ROM_LIBRARY
+  if (dumpPagesPresent(0, numRomBanks * pagesPerBank)) {
+    libraryAddRom();
+  }
+#endif
+
+  // The emulator reads the bank right away, drop what was cached before
+  am_hal_cachectrl_control(AM_HAL_CACHECTRL_CONTROL_FLASH_CACHE_INVALIDATE, 0);
+}
+#endif
@@ -11,21 +11,34 @@
 
 #include "am_mcu_apollo.h"
 #include "cartridge.h"
+#include "emulator_settings.h"
 
 extern uint32_t _s_data_gb, _e_data_gb;
+extern uint32_t _s_gb_dump;
 
 #define GameRomStart ((uintptr_t)(&_s_data_gb))
 #define GameRomEnd ((uintptr_t)(&_e_data_gb))
+#define GameDumpRecordStart ((uintptr_t)(&_s_gb_dump))  // one flash page
 
 #define CartridgeStart 0x0100
 #define CartridgeTitleAddress 0x0134
 #define CartridgeTypeAddress 0x0147
 #define CartridgeRomSizeAddress 0x0148
 #define CartridgeRamSizeAddress 0x0149
+#define CartridgeHeaderChecksumAddress 0x014D
+#define CartridgeGlobalChecksumAddress 0x014E
 
 #define CartridgeRamBankRegisterAddress 0x2100
 #define CartridgeRamBankAddress 0x4000
 #define CartridgeRomBankSize 0x4000
+// Up to 128 banks (2MB), the bank numbers are 8 bit
+#define CartridgeRomSizeMax 6
+
+#define CartridgeRamEnableAddress 0x0000
+#define CartridgeRamEnable 0x0A
+#define CartridgeModeSelectAddress 0x6000
+#define CartridgeRamStart 0xA000
+#define CartridgeRamBankSize 0x2000
 
 uint8_t checkSavedCartridge(const uint8_t* startOfRom);
 
@@ -36,5 +49,29 @@ void cartridgeReadInfo();
 void cartridgeReadRom();
 
 uint32_t cartridgeGetSizeBytes();
+uintptr_t cartridgeRomStart();
+uint32_t cartridgeRamSizeBytes(uint8_t ramSizeCode);
+
+#if CARTRIDGE_RESUME
+uint8_t cartridgeDumpPending();
+uint8_t cartridgeResumeAvailable();
+#endif
+
+#if CARTRIDGE_LAZY
+#if !(ROM_CACHE && CARTRIDGE_RESUME)
+#error "CARTRIDGE_LAZY requires ROM_CACHE and CARTRIDGE_RESUME"
+#endif
+void cartridgeReadRomLazy();
+void cartridgeLazyRestore();
+void cartridgeLazyCancel();
+void cartridgeLoadRomBank(uint8_t romBank);
+#endif
+
+#if EXTERNAL_RAM
+uint8_t cartridgeConnect();
+void cartridgeReadRam(uint32_t offset, uint8_t* data, uint32_t length);
+uint8_t cartridgeWriteRam(uint32_t offset, const uint8_t* data,
+                          uint32_t length);
+#endif
 
 #endif /* LIBS_CARTRIDGE_READER_H_ */
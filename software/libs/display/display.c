@@ -33,6 +33,9 @@ am_hal_iom_config_t DisplayConfigIOM = {
     .ui32NBTxnBufLength = sizeof(DMATCBBuffer) / 4};
 
 DisplayStatus spiWrite(uint8_t* data, uint16_t size, bool blocking);
+static DisplayStatus spiWriteNotify(uint8_t* data, uint16_t size,
+                                    bool blocking, am_hal_iom_callback_t done,
+                                    void* ctxt);
 
 DisplayBuffer displayBuffer;
 #if NUM_PIXELS == 1
@@ -42,6 +45,145 @@ DisplayBufferBW displayBufferBW;
 CHECKPOINT_EXCLUDE_BSS
 void* displaySpiHandle;
 
+// Keeps a burst below the 4KB limit of an IOM transfer
+#define DISPLAY_MAX_BURST_LINES 32
+
+#if DISPLAY_PIPELINE
+/*
+ * Lines are copied into one of two transfer buffers before they are clocked
+ * out, so the renderer can change displayBuffer while the DMA runs. The
+ * completion callback frees the buffer again, a third transfer waits for it.
+ */
+typedef struct {
+  LineBuffer line[DISPLAY_MAX_BURST_LINES];
+  uint8_t dummy[2];
+} __attribute__((aligned(4))) DisplayTransferBuffer;
+
+CHECKPOINT_EXCLUDE_BSS
+static DisplayTransferBuffer transferBuffer[2];
+
+CHECKPOINT_EXCLUDE_BSS
+static volatile bool transferBusy[2];
+
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t transferNext;
+
+static void transferDone(void* ctxt, uint32_t status) {
+  transferBusy[(uint32_t)ctxt] = false;
+}
+
+// Also called by writeLines() when the interrupts are masked
+void am_iomaster1_isr(void);
+#endif
+
+#if DISPLAY_COLOR_MODES
+CHECKPOINT_EXCLUDE_BSS
+static DisplayColorMode colorMode;
+
+// 4bit R/G/B/D to 3bit R/G/B, 8 pixels (4 bytes) into 3 bytes
+static uint8_t* packLine3Bit(uint8_t* out, const uint8_t* data) {
+  for (uint32_t i = 0; i < LINE_SIZE / 2; i += 4) {
+    uint32_t w;
+    memcpy(&w, &data[i], sizeof(w));  // lines are not word aligned
+    w = (w & 0x07070707) | ((w & 0x70707070) >> 1);
+    w = (w & 0x003f003f) | ((w & 0x3f003f00) >> 2);
+    w = (w & 0x00000fff) | ((w & 0x0fff0000) >> 4);
+    *out++ = w;
+    *out++ = w >> 8;
+    *out++ = w >> 16;
+  }
+  return out;
+}
+
+/*
+ * 4bit to black and white, 8 pixels (4 bytes) into 1 byte. Light colors have
+ * the green bit set, gray (red only) is dithered with a checkerboard.
+ */
+static uint8_t* packLine1Bit(uint8_t* out, const uint8_t* data,
+                             uint8_t line) {
+  uint32_t checker = (line & 1) ? 0x10101010 : 0x01010101;
+  for (uint32_t i = 0; i < LINE_SIZE / 2; i += 4) {
+    uint32_t w;
+    memcpy(&w, &data[i], sizeof(w));
+    uint32_t light = (w >> 1) & 0x11111111;
+    uint32_t gray = w & ~(w >> 1) & 0x11111111;
+    w = light | (gray & checker);
+    w = (w | (w >> 3)) & 0x03030303;
+    w = (w | (w >> 6)) & 0x000f000f;
+    *out++ = w | (w >> 12);
+  }
+  return out;
+}
+
+// Packs the lines into a transfer, returns its size
+static uint16_t packLines(uint8_t* out, uint8_t startLine, uint8_t numLines,
+                          Command command) {
+  uint8_t* start = out;
+
+  command.FourBitsData = (colorMode == DISPLAY_MODE_4BIT);
+  command.OneBitData = (colorMode == DISPLAY_MODE_1BIT);
+
+  for (uint8_t line = startLine; line < startLine + numLines; line++) {
+    *out++ = command.asUint8_t;  // dummy byte for all but the first line
+    *out++ = displayBuffer.line[line].address;
+    if (colorMode == DISPLAY_MODE_3BIT) {
+      out = packLine3Bit(out, displayBuffer.line[line].data);
+    } else if (colorMode == DISPLAY_MODE_1BIT) {
+      out = packLine1Bit(out, displayBuffer.line[line].data, line);
+    } else {
+      memcpy(out, displayBuffer.line[line].data, LINE_SIZE_COLOR_BYTES);
+      out += LINE_SIZE_COLOR_BYTES;
+    }
+  }
+  *out++ = 0;
+  *out++ = 0;
+  return out - start;
+}
+
+#if DIRTY_LINES
+static void invalidateLines(uint8_t startLine, uint8_t numLines);
+#endif
+
+void displaySetColorMode(DisplayColorMode mode) {
+  if (mode == colorMode) {
+    return;
+  }
+  colorMode = mode;
+#if DIRTY_LINES
+  // Everything on the LCD is in the old depth
+  invalidateLines(0, NUM_LINES + 1);
+#endif
+}
+
+DisplayColorMode displayColorMode() { return colorMode; }
+#endif
+
+#if DIRTY_LINES
+// Hash of the content last sent per line, 0 when the LCD content is unknown
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t lineHash[NUM_LINES + 1];
+
+// Changed lines that are sent together as one burst
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t pendingStart, pendingLines;
+
+static uint32_t lineHashOf(uint8_t line) {
+  const uint8_t* data = displayBuffer.line[line].data;
+  uint32_t hash = 0x811c9dc5;
+  for (uint32_t i = 0; i < LINE_SIZE_COLOR_BYTES; i += 4) {
+    uint32_t word;
+    memcpy(&word, &data[i], sizeof(word));  // lines are not word aligned
+    hash = (hash ^ word) * 0x01000193;
+    hash ^= hash >> 15;
+  }
+  return hash | 1;
+}
+
+static void invalidateLines(uint8_t startLine, uint8_t numLines) {
+  memset(&lineHash[startLine], 0, numLines * sizeof(lineHash[0]));
+}
+#endif
+
 static const uint8_t reverseBitsTable[] =
     {  // Could be replaced by RBIT ARM instruction
         0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
@@ -79,13 +221,50 @@ void displayWriteLineCpy(uint8_t line, const uint8_t* data) {
 #endif
   memcpy(displayBuffer.line[line].data, data, LINE_SIZE_BYTES);
   displayBuffer.line[line].cmd = command;
+#if DIRTY_LINES
+  invalidateLines(line, 1);
+#endif
 
   spiWrite((uint8_t*)&displayBuffer.line[line], sizeof(LineBuffer) + 2,
            DISPLAY_BLOCKING_WRITES);
 }
 
+static void writeLines(uint8_t startLine, uint8_t numLines);
+
 // writes a single line based on a buffer of a single line.
 void displayWriteLine(uint8_t line) {
+#if DIRTY_LINES
+  uint32_t hash = lineHashOf(line);
+  if (hash == lineHash[line]) {
+    // Unchanged, the burst before can go out already
+    displayFlushLines();
+    return;
+  }
+  lineHash[line] = hash;
+
+  if (pendingLines && line == pendingStart + pendingLines &&
+      pendingLines < DISPLAY_MAX_BURST_LINES) {
+    pendingLines++;
+    return;
+  }
+  displayFlushLines();
+  pendingStart = line;
+  pendingLines = 1;
+#else
+  writeLines(line, 1);
+#endif
+}
+
+#if DIRTY_LINES
+void displayFlushLines() {
+  if (pendingLines) {
+    writeLines(pendingStart, pendingLines);
+    pendingLines = 0;
+  }
+}
+#endif
+
+static void writeLines(uint8_t startLine, uint8_t numLines) {
   Command command = {};
   command.mode = true;
 #if LCD_TYPE == LPM
@@ -95,10 +274,39 @@ void displayWriteLine(uint8_t line) {
   command.FourBitsData = true;
 #endif
 #endif
-  displayBuffer.line[line].cmd = command;
+#if DISPLAY_PIPELINE
+  uint32_t n = transferNext;
+  DisplayTransferBuffer* buffer = &transferBuffer[n];
+
+  // Back-pressure, wait until the DMA is done with this buffer
+  while (transferBusy[n]) {
+    if (__get_PRIMASK()) {
+      // The completion interrupt can't run, service the IOM from here
+      am_iomaster1_isr();
+    }
+  }
 
-  spiWrite((uint8_t*)&displayBuffer.line[line], sizeof(LineBuffer) + 2,
-           DISPLAY_BLOCKING_WRITES);
+#if DISPLAY_COLOR_MODES
+  uint16_t size = packLines((uint8_t*)buffer, startLine, numLines, command);
+#else
+  uint16_t size = numLines * sizeof(LineBuffer) + 2;
+  memcpy(buffer->line, &displayBuffer.line[startLine],
+         numLines * sizeof(LineBuffer));
+  buffer->line[0].cmd = command;
+#endif
+
+  transferBusy[n] = !DISPLAY_BLOCKING_WRITES;
+  if (spiWriteNotify((uint8_t*)buffer, size, DISPLAY_BLOCKING_WRITES,
+                     transferDone, (void*)n) != DISPLAY_SUCCESS) {
+    transferBusy[n] = false;
+  }
+  transferNext = n ^ 1;
+#else
+  displayBuffer.line[startLine].cmd = command;
+
+  spiWrite((uint8_t*)&displayBuffer.line[startLine],
+           numLines * sizeof(LineBuffer) + 2, DISPLAY_BLOCKING_WRITES);
+#endif
 }
 
 void displayWriteScreen() {
@@ -112,6 +320,10 @@ void displayWriteScreen() {
 #endif
 #endif
   displayBuffer.line[1].cmd = command;
+#if DIRTY_LINES
+  pendingLines = 0;
+  invalidateLines(1, NUM_LINES);
+#endif
 
   spiWrite((uint8_t*)&displayBuffer.line[1],
            (NUM_LINES * sizeof(LineBuffer)) + 2, DISPLAY_BLOCKING_WRITES);
@@ -171,6 +383,9 @@ void displayWriteMultipleLines(uint8_t startLine, uint8_t numLines) {
 #endif
 
   displayBuffer.line[startLine].cmd = command;
+#if DIRTY_LINES
+  invalidateLines(startLine, numLines);
+#endif
 
   spiWrite((uint8_t*)&displayBuffer.line[startLine],
            numLines * sizeof(LineBuffer) + 2, DISPLAY_BLOCKING_WRITES);
@@ -179,6 +394,10 @@ void displayWriteMultipleLines(uint8_t startLine, uint8_t numLines) {
 
 static void displayClearAll() {
   uint8_t spiBuffer[2];
+#if DIRTY_LINES
+  pendingLines = 0;
+  invalidateLines(0, NUM_LINES + 1);
+#endif
   Command command = {};
   command.allClear = true;
 
@@ -188,6 +407,13 @@ static void displayClearAll() {
 }
 
 DisplayStatus spiWrite(uint8_t* data, uint16_t size, bool blocking) {
+  return spiWriteNotify(data, size, blocking, NULL, NULL);
+}
+
+// done is called from the IOM interrupt once a non-blocking write finished
+static DisplayStatus spiWriteNotify(uint8_t* data, uint16_t size,
+                                    bool blocking, am_hal_iom_callback_t done,
+                                    void* ctxt) {
   am_hal_iom_transfer_t transaction = {};
   transaction.eDirection = AM_HAL_IOM_TX;
   transaction.ui32NumBytes = size;
@@ -200,8 +426,8 @@ DisplayStatus spiWrite(uint8_t* data, uint16_t size, bool blocking) {
       return DISPLAY_ERROR;
     }
   } else {
-    if (am_hal_iom_nonblocking_transfer(displaySpiHandle, &transaction, NULL,
-                                        0)) {
+    if (am_hal_iom_nonblocking_transfer(displaySpiHandle, &transaction, done,
+                                        ctxt)) {
       return DISPLAY_ERROR;
     }
   }
@@ -286,6 +512,30 @@ static void setComTimer(bool state) {
   }
 }
 
+// Power-up timing of the LCD, in system timer ticks (3MHz)
+#define DISPLAY_POWER_UP_TICKS (1000 * 3)  // 1ms
+#define DISPLAY_ENABLE_TICKS (30 * 3)      // 30us
+
+typedef enum {
+  DISPLAY_POWER_OFF,
+  DISPLAY_POWERING_UP,
+  DISPLAY_ENABLING,
+  DISPLAY_POWER_READY
+} DisplayPowerState;
+
+CHECKPOINT_EXCLUDE_BSS
+static volatile DisplayPowerState displayPowerState;
+
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t clearAllBuffer[2];
+
+CHECKPOINT_EXCLUDE_BSS
+static void (*displayReadyCallback)(void);
+
+// System timer at displayPowerUpStart(), 0 when not powered early
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t displayPowerUpTime;
+
 // Can be called at any point but is required before screen writes are executed
 void displaySetup() { populateAddressInBuffer(); }
 
@@ -307,12 +557,108 @@ void displayConfig() {
 
   displayInvertComInit();
   setComTimer(true);
+  displayPowerState = DISPLAY_POWER_READY;
+}
+
+static void displayPowerStep(void) {
+  am_hal_stimer_int_clear(AM_HAL_STIMER_INT_COMPAREA);
+  if (displayPowerState == DISPLAY_POWERING_UP) {
+    Command command = {};
+    command.allClear = true;
+    clearAllBuffer[0] = command.asUint8_t;
+    spiWrite(clearAllBuffer, 2, false);
+
+    am_hal_gpio_state_write(DISPLAY_DISP_PIN, AM_HAL_GPIO_OUTPUT_SET);
+    displayPowerState = DISPLAY_ENABLING;
+    am_hal_stimer_compare_delta_set(0, DISPLAY_ENABLE_TICKS);
+  } else if (displayPowerState == DISPLAY_ENABLING) {
+    displayInvertComInit();
+    setComTimer(true);
+    displayPowerState = DISPLAY_POWER_READY;
+    am_hal_stimer_int_disable(AM_HAL_STIMER_INT_COMPAREA);
+    if (displayReadyCallback) {
+      displayReadyCallback();
+    }
+  }
 }
 
+void am_stimer_cmpr0_isr(void) { displayPowerStep(); }
+
+static void displayPowerOn(void) {
+  am_hal_gpio_pinconfig(DISPLAY_EXTCOM_PIN, g_AM_HAL_GPIO_OUTPUT);
+  am_hal_gpio_state_write(DISPLAY_EXTCOM_PIN, AM_HAL_GPIO_OUTPUT_CLEAR);
+
+  am_hal_gpio_pinconfig(DISPLAY_DISP_PIN, g_AM_HAL_GPIO_OUTPUT);
+  am_hal_gpio_state_write(DISPLAY_DISP_PIN, AM_HAL_GPIO_OUTPUT_CLEAR);
+
+  setDisplayPower(true);
+}
+
+/*
+ * Only switches the LCD supply on, without interrupts, so its power-up time
+ * overlaps with the restore. displayConfigAsync() waits for the rest of it.
+ */
+void displayPowerUpStart(void) {
+  displayPowerOn();
+  displayPowerUpTime = am_hal_stimer_counter_get() | 1;
+}
+
+/*
+ * Same as displayConfig() but without the blocking power-up delays, the
+ * remaining steps are done from the system timer compare interrupt. Lines
+ * written before displayReady() are lost, onReady (called from the interrupt)
+ * can be used to redraw the screen.
+ */
+void displayConfigAsync(void (*onReady)(void)) {
+  displayReadyCallback = onReady;
+#if DIRTY_LINES
+  // The LCD is cleared during the power-up
+  pendingLines = 0;
+  invalidateLines(0, NUM_LINES + 1);
+#endif
+
+  uint32_t powerUpTicks = DISPLAY_POWER_UP_TICKS;
+  if (displayPowerUpTime) {
+    // Powered by displayPowerUpStart(), only wait for the rest
+    uint32_t elapsed = am_hal_stimer_counter_get() - displayPowerUpTime;
+    powerUpTicks = (elapsed < DISPLAY_POWER_UP_TICKS)
+                       ? DISPLAY_POWER_UP_TICKS - elapsed
+                       : 1;
+    displayPowerUpTime = 0;
+  } else {
+    displayPowerOn();
+  }
+
+  spiInit();
+
+  displayPowerState = DISPLAY_POWERING_UP;
+  am_hal_stimer_config(CTIMER->STCFG | AM_HAL_STIMER_CFG_COMPARE_A_ENABLE);
+  am_hal_stimer_int_clear(AM_HAL_STIMER_INT_COMPAREA);
+  am_hal_stimer_compare_delta_set(0, powerUpTicks);
+  am_hal_stimer_int_enable(AM_HAL_STIMER_INT_COMPAREA);
+  NVIC_EnableIRQ(STIMER_CMPR0_IRQn);
+  am_hal_interrupt_master_enable();
+}
+
+bool displayReady() { return displayPowerState == DISPLAY_POWER_READY; }
+
 void displayShutdown() {
   am_hal_gpio_state_write(DISPLAY_DISP_PIN, AM_HAL_GPIO_OUTPUT_CLEAR);
   setComTimer(false);
   displayClearAll();
   am_util_delay_us(30);
   setDisplayPower(false);
+  displayPowerState = DISPLAY_POWER_OFF;
+
+  // Power down the SPI, displayConfig() brings it up again
+  NVIC_DisableIRQ(IOMSTR1_IRQn);
+  am_hal_iom_disable(displaySpiHandle);
+  am_hal_iom_power_ctrl(displaySpiHandle, AM_HAL_SYSCTRL_DEEPSLEEP, false);
+  am_hal_iom_uninitialize(displaySpiHandle);
+
+#if DISPLAY_PIPELINE
+  // Queued transfers are dropped, their callbacks never come
+  transferBusy[0] = false;
+  transferBusy[1] = false;
+#endif
 }
@@ -50,6 +50,13 @@
 
 typedef enum { DISPLAY_SUCCESS, DISPLAY_ERROR } DisplayStatus;
 
+// Bits per pixel sent to the LCD, the display buffer always holds 4 bits
+typedef enum {
+  DISPLAY_MODE_4BIT,  // R/G/B/D
+  DISPLAY_MODE_3BIT,  // R/G/B, the unused D bit is dropped
+  DISPLAY_MODE_1BIT   // black and white
+} DisplayColorMode;
+
 typedef union {
   struct {
     uint8_t mode : 1;
@@ -90,15 +97,28 @@ typedef struct {
 
 void displaySetup();
 void displayConfig();
+void displayConfigAsync(void (*onReady)(void));
+void displayPowerUpStart(void);
+bool displayReady();
 void displayShutdown();
 
 void displayWriteLine(uint8_t line);
+#if DIRTY_LINES
+// Sends the changed lines displayWriteLine() is still holding back
+void displayFlushLines();
+#endif
 void displayWriteScreen();
 
 void displayWriteBar(uint8_t percentFilled);
 void displayWriteMultipleLines(uint8_t startLine, uint8_t numLines);
 void displayWriteLineCpy(uint8_t line, const uint8_t* data);
 
+#if DISPLAY_COLOR_MODES
+// Applies to the lines written with displayWriteLine()
+void displaySetColorMode(DisplayColorMode mode);
+DisplayColorMode displayColorMode();
+#endif
+
 #if NUM_PIXELS == 1
 void displayWriteLineBW(uint8_t line);
 #endif
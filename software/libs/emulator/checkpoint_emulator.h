@@ -1,8 +1,19 @@
 #ifndef CHECKPOINT_EMULATOR_H_
 #define CHECKPOINT_EMULATOR_H_
 
+#include "boot_timing.h"
 #include "emulator.h"
 
+/*
+ * Runs before the stack and the MPatch patches are restored, so it must not
+ * enable any interrupt whose handler uses the restored state
+ */
+static inline size_t restore_emulator_early(void) {
+  bootTimingMark(BOOT_PHASE_IO);
+  emulatorPowerUpIO();
+  return 0;
+}
+
 static inline size_t restore_emulator(void) {
   emulatorConfigIO();
   return 0;
@@ -9,9 +9,13 @@
 #include "emulator.h"
 
 #include "am_util.h"
+#include "boot_timing.h"
 #include "buttons.h"
+#include "fram.h"
 #include "gameboy_ub.h"
 #include "jit_checkpoint.h"
+#include "memtracker.h"
+#include "pc_sampling.h"
 #include "reader.h"
 
 #ifdef CHECKPOINT
@@ -25,13 +29,50 @@ UB_GB_File Stored_ROM = {
 
 void emulatorSetRomSize(uint32_t size) {
   Stored_ROM.size = size;
-  Stored_ROM.table = (uint8_t*)GameRomStart;
+  Stored_ROM.table = (uint8_t*)cartridgeRomStart();
 }
 
+// Redraw the whole screen from the display buffer
+static void emulatorRedrawScreen(void) {
+#ifdef LCD_COLOR
+  displayWriteScreen();
+#else
+  for (uint8_t line = 1; line <= NUM_LINES; line++) {
+    updateLineBW(line);
+  }
+#endif
+}
+
+static void emulatorDisplayReady(void) {
+  // Anything drawn while the display was powering up is lost
+  emulatorRedrawScreen();
+  bootTimingMark(BOOT_PHASE_DISPLAY);
+  bootTimingReport();
+}
+
+/*
+ * Does not block, the display finishes its power-up in the background. This
+ * keeps the restore path free of delays.
+ */
 void emulatorConfigIO(void) {
-  displayConfig();
+  displayConfigAsync(emulatorDisplayReady);
   buttonsConfig();
   jit_setup();
+#if PC_SAMPLING
+  pcSamplingStart();
+#endif
+}
+
+// Starts the slow peripheral power-up, no interrupts are enabled yet
+void emulatorPowerUpIO(void) { displayPowerUpStart(); }
+
+// Called when execution continues from a restored checkpoint
+void emulatorResume(void) {
+#if ROM_CACHE
+  // The ROM cache is not part of the checkpoint
+  gameboy_rom_cache_reset();
+#endif
+  bootTimingMark(BOOT_PHASE_RESTORE);
 }
 
 void emulatorSetup() {
@@ -77,22 +118,132 @@ void updateLineBW(uint8_t line) {
 #endif
 #endif
 
+#if defined(CHECKPOINT) && HIBERNATE
+/*
+ * Power down the peripherals and deep sleep until a button is pressed or the
+ * voltage recovered. SRAM is retained so we continue without a restore, the
+ * checkpoint taken before covers a power failure during hibernation.
+ */
+static void emulatorHibernate(void) {
+  uint32_t wakemV = jitSampleTomV(adcMeasurement) + HIBERNATE_HYSTERESIS_MV;
+  if (wakemV < hibernateWakemV) {
+    wakemV = hibernateWakemV;
+  }
+
+  displayShutdown();
+  framShutdown(true);
+  jit_hibernate(wakemV);
+
+  uint32_t critical = am_hal_interrupt_master_disable();
+  while (!jit_wakeup) {
+    am_hal_sysctrl_sleep(AM_HAL_SYSCTRL_SLEEP_DEEP);
+
+    // Let the pending interrupt set the wake-up flag
+    am_hal_interrupt_master_set(critical);
+    critical = am_hal_interrupt_master_disable();
+  }
+  am_hal_interrupt_master_set(critical);
+
+  jit_resume();
+  framConfig();
+  displayConfig();
+  emulatorRedrawScreen();
+}
+#endif
+
+#if FRAME_SKIP
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t frameSkipCount;
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t frameField;
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t frameKeyBtn, frameKeyCursor;
+
+/*
+ * The CPU runs every frame, but with less harvested energy only every Nth
+ * frame is rendered, N grows from 1 at FRAME_SKIP_FULL_MV up to FRAME_SKIP_MAX
+ * at jitTriggermV. Below FRAME_SKIP_INTERLACE_MV the rendered frames only draw
+ * every other line, below DISPLAY_1BIT_MV they are sent in black and white.
+ * A change of the buttons always draws a full frame.
+ */
+uint8_t emulatorFrameDraw(void) {
+  // No voltage sample yet
+  uint32_t mV = FRAME_SKIP_FULL_MV;
+  if (adcMeasurement != 0) {
+    mV = jitSampleTomV(adcMeasurement);
+  }
+
+#if defined(LCD_COLOR) && DISPLAY_COLOR_MODES
+  displaySetColorMode((mV < DISPLAY_1BIT_MV) ? DISPLAY_MODE_1BIT
+                                             : DISPLAY_MODE_3BIT);
+#endif
+
+  if (GB.key.code_btn != frameKeyBtn || GB.key.code_cursor != frameKeyCursor) {
+    frameKeyBtn = GB.key.code_btn;
+    frameKeyCursor = GB.key.code_cursor;
+    frameSkipCount = 0;
+    return FRAME_DRAW_ALL;
+  }
+
+  uint32_t skip = 1;
+  if (mV < FRAME_SKIP_FULL_MV) {
+    skip = FRAME_SKIP_MAX;
+    if (mV > jitTriggermV) {
+      skip = 1 + ((FRAME_SKIP_FULL_MV - mV) * (FRAME_SKIP_MAX - 1)) /
+                     (FRAME_SKIP_FULL_MV - jitTriggermV);
+    }
+  }
+
+  if (++frameSkipCount < skip) {
+    return FRAME_DRAW_NONE;
+  }
+  frameSkipCount = 0;
+
+  if (mV < FRAME_SKIP_INTERLACE_MV) {
+    frameField ^= 1;
+    return FRAME_DRAW_EVEN + frameField;
+  }
+  return FRAME_DRAW_ALL;
+}
+#endif
+
 CHECKPOINT_EXCLUDE_BSS
 uint8_t jitCheckpointcount = 0;
 
 void emulatorRun() {
+#if defined(CHECKPOINT) && LAZY_RESTORE
+  uint32_t lazyRestoreCountdown = LAZY_RESTORE_INTERVAL;
+#endif
   while (true) {
     gameboy_single_step();
 #ifdef CHECKPOINT
+#if LAZY_RESTORE
+    // Stream in the memory that was not accessed since the restore
+    if (lazyRegions && --lazyRestoreCountdown == 0) {
+      lazyRestoreCountdown = LAZY_RESTORE_INTERVAL;
+      restoreNextLazyRegion();
+    }
+#endif
     if (jit_checkpoint) {
-      if (jitCheckpointcount == 0) {
+      // A forecast brownout can not wait for the next threshold trigger,
+      // jit_checkpoint_end() holds the forecast off for a window of samples
+      if (jitCheckpointcount == 0 || jit_checkpoint == JIT_TRIGGER_FORECAST) {
         jitCheckpointcount = 5;
-        checkpoint();
+        jit_checkpoint_begin();
+        if (checkpoint() == 0) {
+          // Only learn from checkpoints that were not interrupted
+          jit_checkpoint_end();
+#if HIBERNATE
+          emulatorHibernate();
+#endif
+        } else {
+          emulatorResume();
+        }
       } else {
         jitCheckpointcount--;
       }
 
-      jit_checkpoint = 0;
+      jit_checkpoint = JIT_TRIGGER_NONE;
     }
 #endif
   }
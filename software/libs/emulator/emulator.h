@@ -14,8 +14,21 @@
 #include "emulator_settings.h"
 
 void emulatorConfigIO(void);
+void emulatorPowerUpIO(void);
 void emulatorSetup(void);
 void emulatorRun(void);
+void emulatorResume(void);
 void emulatorSetRomSize(uint32_t size);
 
+#if FRAME_SKIP
+// Lines of a frame that are rendered and sent to the display
+#define FRAME_DRAW_ALL 0
+#define FRAME_DRAW_NONE 1
+#define FRAME_DRAW_EVEN 2
+#define FRAME_DRAW_ODD 3
+
+// Called by the emulator at the start of every frame, returns FRAME_DRAW_*
+uint8_t emulatorFrameDraw(void);
+#endif
+
 #endif /* LIBS_EMULATOR_EMULATOR_H_ */
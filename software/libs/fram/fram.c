@@ -0,0 +1,246 @@
+/*
+ * fram.c
+ *
+ *  Created on: Dec 25, 2019
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "fram.h"
+
+#include "am_mcu_apollo.h"
+#include "am_util.h"
+#include "mspi.h"
+#include "platform.h"
+
+#include <string.h>
+
+#define MSPI_TEST_MODULE 0
+
+CHECKPOINT_EXCLUDE_BSS uint32_t DMATCBBuffer_FRAM[2560];
+
+extern void* g_pMSPIHandle;
+
+typedef struct {
+  uint8_t* dst;
+  uint32_t address;  // FRAM address
+  uint32_t size;
+} FramReadDescriptor;
+
+// Everything used during a read is excluded from the checkpoint, as the
+// reads are used to restore the .data and .bss sections.
+CHECKPOINT_EXCLUDE_BSS
+static FramReadDescriptor framReadList[FRAM_READ_LIST_LENGTH];
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t framReadCount;
+
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t __attribute__((aligned(4))) framDMABuffer[2][FRAM_DMA_CHUNK];
+CHECKPOINT_EXCLUDE_BSS
+static volatile bool framDMADone[2];
+
+CHECKPOINT_EXCLUDE_BSS
+static bool framDMAReady;
+
+const am_hal_mspi_dev_config_t MSPI_Flash_Serial_CE0_MSPIConfig = {
+    .eSpiMode = AM_HAL_MSPI_SPI_MODE_0,
+    .eClockFreq = AM_HAL_MSPI_CLK_24MHZ,
+    .ui8TurnAround = 0,
+    .eAddrCfg = AM_HAL_MSPI_ADDR_3_BYTE,
+    .eInstrCfg = AM_HAL_MSPI_INSTR_1_BYTE,
+    .eDeviceConfig = AM_HAL_MSPI_FLASH_SERIAL_CE0,
+    .bSeparateIO = true,
+    .bSendInstr = true,
+    .bSendAddr = true,
+    .bTurnaround = true,
+    .ui8ReadInstr = FRAM_READ_MEM_CODE,
+    .ui8WriteInstr = FRAM_WRITE_MEM_CODE,
+    .ui32TCBSize = (sizeof(DMATCBBuffer_FRAM) / sizeof(uint32_t)),
+    .pTCB = DMATCBBuffer_FRAM,
+    .scramblingStartAddr = 0,
+    .scramblingEndAddr = 0,
+};
+
+int framConfig(void) {
+  uint32_t ui32Status;
+  void* pHandle = NULL;
+
+  //
+  // Configure the MSPI and Flash Device.
+  //
+  ui32Status = am_devices_mspi_psram_init(
+      MSPI_TEST_MODULE,
+      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig, &pHandle);
+  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
+    am_util_stdio_printf(
+        "Failed to configure the MSPI and Flash Device correctly!\n");
+    return -1;
+  }
+
+  //
+  // Set up for XIP operation.
+  //
+  ui32Status = am_devices_mspi_psram_enable_xip();
+  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
+    am_util_stdio_printf("Failed to enable XIP mode in the MSPI!\n");
+    return -2;
+  }
+
+  framReadCount = 0;
+  framDMAReady = true;
+
+  return 0;
+}
+
+int framShutdown(bool sleep) {
+  uint32_t ui32Status;
+
+  framReadFlush();
+  framDMAReady = false;
+
+  //
+  // Shutdown XIP operation.
+  //
+  ui32Status = am_devices_mspi_psram_disable_xip();
+  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
+    am_util_stdio_printf("Failed to disable XIP mode in the MSPI!\n");
+    return -2;
+  }
+
+  if (sleep) {
+    // Contents are retained, wakes up on the next chip select
+    am_devices_mspi_psram_sleep();
+  }
+
+  // The deinit disables the interrupts, keep the callers state instead
+  uint32_t primask = am_hal_interrupt_master_disable();
+
+  //
+  // Clean up the MSPI before exit.
+  //
+  ui32Status = am_devices_mspi_psram_deinit(
+      MSPI_TEST_MODULE,
+      (am_hal_mspi_dev_config_t*)&MSPI_Flash_Serial_CE0_MSPIConfig);
+
+  am_hal_interrupt_master_set(primask);
+
+  if (AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS != ui32Status) {
+    am_util_stdio_printf("Failed to shutdown the MSPI and Flash Device!\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+static void framDMACallback(void* pCallbackCtxt, uint32_t status) {
+  *(volatile bool*)pCallbackCtxt = true;
+}
+
+static bool framDMAStart(uint8_t buffer, uint32_t address, uint32_t size) {
+  framDMADone[buffer] = false;
+  return am_devices_mspi_psram_nonblocking_read(
+             framDMABuffer[buffer], address, size, framDMACallback,
+             (void*)&framDMADone[buffer]) == AM_DEVICES_MSPI_PSRAM_STATUS_SUCCESS;
+}
+
+// Poll the MSPI instead of waiting for its interrupt, reads are also done
+// from fault handlers (lazy restore) and with the interrupts disabled.
+static void framDMAWait(uint8_t buffer) {
+  while (!framDMADone[buffer]) {
+    uint32_t ui32Status;
+    am_hal_mspi_interrupt_status_get(g_pMSPIHandle, &ui32Status, false);
+    am_hal_mspi_interrupt_clear(g_pMSPIHandle, ui32Status);
+    am_hal_mspi_interrupt_service(g_pMSPIHandle, ui32Status);
+  }
+}
+
+/*
+ * Execute the queued reads. The transfers are split in chunks and alternate
+ * between two SRAM buffers: while one chunk is fetched by the DMA, the
+ * previous one is copied to its destination.
+ */
+void framReadFlush(void) {
+  if (framReadCount == 0) {
+    return;
+  }
+
+  uint32_t primask = am_hal_interrupt_master_disable();
+
+  uint8_t* pending[2] = {NULL, NULL};  // destination of the buffer content
+  uint32_t pendingSize[2];
+  uint8_t buffer = 0;
+
+  for (uint32_t i = 0; i < framReadCount; i++) {
+    FramReadDescriptor* read = &framReadList[i];
+
+    for (uint32_t offset = 0; offset < read->size; offset += FRAM_DMA_CHUNK) {
+      uint32_t size = read->size - offset;
+      if (size > FRAM_DMA_CHUNK) {
+        size = FRAM_DMA_CHUNK;
+      }
+
+      if (framDMAStart(buffer, read->address + offset, size)) {
+        pending[buffer] = read->dst + offset;
+        pendingSize[buffer] = size;
+      } else {
+        // Fall back to XIP, not while the other buffer is still fetched
+        if (pending[buffer ^ 1]) {
+          framDMAWait(buffer ^ 1);
+        }
+        memcpy(read->dst + offset,
+               (const uint8_t*)(FRAM_XIP_BASE + read->address + offset), size);
+      }
+
+      // Copy the other buffer while this one is fetched
+      buffer ^= 1;
+      if (pending[buffer]) {
+        framDMAWait(buffer);
+        memcpy(pending[buffer], framDMABuffer[buffer], pendingSize[buffer]);
+        pending[buffer] = NULL;
+      }
+    }
+  }
+
+  // The last chunk
+  buffer ^= 1;
+  if (pending[buffer]) {
+    framDMAWait(buffer);
+    memcpy(pending[buffer], framDMABuffer[buffer], pendingSize[buffer]);
+  }
+
+  framReadCount = 0;
+
+  am_hal_interrupt_master_set(primask);
+}
+
+/*
+ * Queue a read from the FRAM, the destination is only valid after
+ * framReadFlush(). Small reads, or reads from outside of the FRAM, are
+ * executed immediately.
+ */
+void* framReadQueue(void* dst, const void* src, size_t n) {
+  uint32_t address = (uint32_t)src - FRAM_XIP_BASE;
+
+  if (!framDMAReady || n < FRAM_DMA_MIN || (uint32_t)src < FRAM_XIP_BASE ||
+      address + n > FRAM_SIZE) {
+    return memcpy(dst, src, n);
+  }
+
+  if (framReadCount == FRAM_READ_LIST_LENGTH) {
+    framReadFlush();
+  }
+
+  framReadList[framReadCount].dst = dst;
+  framReadList[framReadCount].address = address;
+  framReadList[framReadCount].size = n;
+  framReadCount++;
+
+  return dst;
+}
+
+// Read from the FRAM with DMA, together with the reads still queued
+void* framRead(void* dst, const void* src, size_t n) {
+  framReadQueue(dst, src, n);
+  framReadFlush();
+  return dst;
+}
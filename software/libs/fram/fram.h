@@ -9,6 +9,9 @@
 #ifndef LIBS_FRAM_FRAM_H_
 #define LIBS_FRAM_FRAM_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+
 // SPI commands
 #define FRAM_SET_WRITE_EN_LATCH 0x06
 #define FRAM_RESET_WRITE_EN_LATCH 0x04
@@ -23,4 +26,24 @@
 
 #define FRAM_REF_ID 0x03497F04  // ID to be expected when reading dev id.
 
+// Time for the FRAM to leave sleep mode after chip select (tREC)
+#define FRAM_WAKE_US 450
+
+// Base address of the FRAM in XIP mode (NVMEM in the linker script)
+#define FRAM_XIP_BASE 0x51000000UL
+#define FRAM_SIZE (512 * 1024)
+
+// Bulk reads with DMA, copied to the destination through two SRAM buffers
+#define FRAM_DMA_CHUNK 1024      // bytes per DMA transfer
+#define FRAM_DMA_MIN 64          // smaller reads are done through XIP
+#define FRAM_READ_LIST_LENGTH 32 // queued reads before a flush
+
+int framConfig(void);
+int framShutdown(bool sleep);
+
+// memcpy() replacements for reads from the XIP mapped FRAM
+void* framRead(void* dst, const void* src, size_t n);
+void* framReadQueue(void* dst, const void* src, size_t n);
+void framReadFlush(void);
+
 #endif  // LIBS_FRAM_FRAM_H_
@@ -246,6 +246,24 @@ uint32_t am_devices_mspi_psram_set_wel(bool wel) {
   return AM_HAL_STATUS_SUCCESS;
 }
 
+uint32_t am_devices_mspi_psram_sleep(void) {
+  //
+  // Send the sleep command, the device wakes up on the next chip select.
+  //
+  return am_device_command_write(FRAM_SLEEP_MODE, false, 0, 0, 0);
+}
+
+uint32_t am_devices_mspi_psram_wake(void) {
+  uint32_t ui32DeviceID = 0;
+
+  //
+  // Any chip select wakes the device, the command itself is discarded.
+  //
+  am_device_command_read(FRAM_READ_DEV_ID, false, 0, &ui32DeviceID, 4);
+  am_util_delay_us(FRAM_WAKE_US);
+  return AM_HAL_STATUS_SUCCESS;
+}
+
 //
 // Device specific initialization function.
 //
@@ -253,6 +271,11 @@ uint32_t am_device_init_psram(am_hal_mspi_dev_config_t* psMSPISettings) {
   uint32_t ui32Status = AM_HAL_STATUS_SUCCESS;
 
   ui32Status = am_devices_mspi_psram_id();
+  if (AM_HAL_STATUS_SUCCESS != ui32Status) {
+    // The device might still be in sleep mode
+    am_devices_mspi_psram_wake();
+    ui32Status = am_devices_mspi_psram_id();
+  }
   uint8_t sram_status = am_devices_mspi_psram_status();
   am_devices_mspi_psram_set_wel(true);
   sram_status = am_devices_mspi_psram_status();
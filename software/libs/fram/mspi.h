@@ -29,6 +29,10 @@ uint32_t am_devices_mspi_psram_write(uint8_t* ui8TxBuffer,
                                      uint32_t ui32NumBytes,
                                      bool bWaitForCompletion);
 
+uint32_t am_devices_mspi_psram_sleep(void);
+
+uint32_t am_devices_mspi_psram_wake(void);
+
 uint32_t am_devices_mspi_psram_enable_xip(void);
 
 uint32_t am_devices_mspi_psram_disable_xip(void);
@@ -34,11 +34,201 @@ volatile char jit_checkpoint = 0;
 CHECKPOINT_EXCLUDE_DATA
 volatile uint16_t adcMeasurement = 0;
 
+// Hibernation, set by the ADC or a button when we have to wake up again
+CHECKPOINT_EXCLUDE_BSS
+static volatile bool jitHibernating;
+CHECKPOINT_EXCLUDE_BSS
+volatile bool jit_wakeup;
+
 // ADC Pin
 const am_hal_gpio_pincfg_t g_AM_PIN_29_ADCSE1 = {
     .uFuncSel = JIT_ADC_PIN_CFG,
 };
 
+#define AdcTimer 3
+#define ComTimerClkSource AM_HAL_CTIMER_HFRC_12KHZ
+#define PERIOD 10
+#define NUM_PULSES_PERIOD ((12000 / (PERIOD * 2)) - 1)
+
+#define JIT_SAMPLE_PERIOD_MS (((NUM_PULSES_PERIOD + 1) * 1000) / 12000)
+#define JIT_STIMER_TICKS_PER_MS 3000
+
+// Known sample: 6434 (14 bit) is 3499 mV, the trigger level is ~6434 << 6
+_Static_assert(jitSampleTomV(6434) == 3499, "ADC sample to mV conversion");
+_Static_assert(jitSampleTomV(jitmVToSample(jitTriggermV) >> 6) >=
+                   jitTriggermV - 1,
+               "ADC sample and window limit scales differ");
+
+#if JIT_FORECAST
+// Voltage history, only valid for the current power cycle
+CHECKPOINT_EXCLUDE_BSS
+static uint16_t jitHistory[JIT_HISTORY_LENGTH];
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t jitHistoryHead;
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t jitHistoryCount;
+CHECKPOINT_EXCLUDE_BSS
+static uint8_t jitSamplesSincePress;
+CHECKPOINT_EXCLUDE_BSS
+static uint16_t jitPressBaseline;
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t jitCheckpointStart;
+CHECKPOINT_EXCLUDE_BSS
+static volatile int32_t jitSlope;
+CHECKPOINT_EXCLUDE_BSS
+static volatile uint32_t jitTimeToBrownout = UINT32_MAX;
+
+// Learned energy model, part of the checkpoint so it survives power cycles
+static int32_t jitDrainSlope;           // mV/s without button presses
+static int32_t jitPressGain;            // mV harvested per button press
+static uint32_t jitPressInterval;       // samples between button presses
+static uint32_t jitCheckpointTicks;     // stimer ticks per checkpoint
+
+/*
+ * Least-squares slope over the history in mV/s.
+ */
+static int32_t historySlope(void) {
+  int32_t num = 0;
+  for (uint8_t i = 0; i < JIT_HISTORY_LENGTH; i++) {
+    // Oldest sample is at the head
+    uint8_t idx = (jitHistoryHead + i) % JIT_HISTORY_LENGTH;
+    num += (2 * i - (JIT_HISTORY_LENGTH - 1)) * (int32_t)jitHistory[idx];
+  }
+  // sum((2i - (n - 1))^2) / 2 = n(n^2 - 1) / 6
+  const int32_t den =
+      (JIT_HISTORY_LENGTH * (JIT_HISTORY_LENGTH * JIT_HISTORY_LENGTH - 1)) / 6;
+  return (num * 1000) / (den * JIT_SAMPLE_PERIOD_MS);
+}
+
+/*
+ * Expected harvest from the user pressing buttons in mV/s, zero when the user
+ * stopped pressing buttons.
+ */
+static int32_t pressHarvestSlope(void) {
+  if (jitPressInterval == 0 || jitSamplesSincePress > 2 * jitPressInterval) {
+    return 0;
+  }
+  return (jitPressGain * 1000) /
+         (int32_t)(jitPressInterval * JIT_SAMPLE_PERIOD_MS);
+}
+
+static void learnPress(uint16_t mV) {
+  // Voltage gained after a press compared to the expected drain
+  int32_t gain = (int32_t)mV - (int32_t)jitPressBaseline -
+                 (jitDrainSlope * JIT_PRESS_WINDOW * JIT_SAMPLE_PERIOD_MS) /
+                     1000;
+  if (gain < 0) {
+    gain = 0;
+  }
+  jitPressGain += (gain - jitPressGain) / 4;
+}
+
+/*
+ * Returns true when a brownout is expected before a checkpoint can finish.
+ */
+static bool forecast(uint16_t mV) {
+  jitHistory[jitHistoryHead] = mV;
+  jitHistoryHead = (jitHistoryHead + 1) % JIT_HISTORY_LENGTH;
+  if (jitHistoryCount < JIT_HISTORY_LENGTH) {
+    jitHistoryCount++;
+  }
+  if (jitSamplesSincePress < UINT8_MAX) {
+    jitSamplesSincePress++;
+  }
+  if (jitSamplesSincePress == JIT_PRESS_WINDOW) {
+    learnPress(mV);
+  }
+
+  if (jitHistoryCount < JIT_HISTORY_LENGTH) {
+    // Not enough history, leave it to the comparator
+    jitTimeToBrownout = UINT32_MAX;
+    return false;
+  }
+
+  int32_t slope = historySlope();
+  if (jitSamplesSincePress >= JIT_HISTORY_LENGTH) {
+    // Clean window: learn the drain (includes solar input)
+    jitDrainSlope += (slope - jitDrainSlope) / 8;
+  } else {
+    // A press bump distorts the history, use the learned model unless the
+    // measured drop is steeper
+    int32_t model = jitDrainSlope + pressHarvestSlope();
+    if (model < slope) {
+      slope = model;
+    }
+  }
+  jitSlope = slope;
+
+  if (slope >= 0 || mV <= jitBrownoutmV) {
+    jitTimeToBrownout = (slope >= 0) ? UINT32_MAX : 0;
+    return slope < 0;
+  }
+
+  uint32_t ttb = ((uint32_t)(mV - jitBrownoutmV) * 1000) / (uint32_t)(-slope);
+  jitTimeToBrownout = ttb;
+
+  uint32_t checkpointMs = jitCheckpointTicks / JIT_STIMER_TICKS_PER_MS;
+  if (checkpointMs == 0) {
+    checkpointMs = JIT_CHECKPOINT_INITIAL_MS;
+  }
+  // The next sample arrives one period later, so include it in the budget
+  return ttb <= checkpointMs * JIT_FORECAST_MARGIN + JIT_SAMPLE_PERIOD_MS;
+}
+
+void jit_button_event(void) {
+  if (jitHibernating) {
+    // The press harvested energy, try to continue
+    jit_wakeup = true;
+    return;
+  }
+  if (jitSamplesSincePress < JIT_PRESS_WINDOW) {
+    // Part of the same burst of presses
+    return;
+  }
+  if (jitSamplesSincePress != UINT8_MAX) {
+    jitPressInterval += ((int32_t)jitSamplesSincePress -
+                         (int32_t)jitPressInterval) / 4;
+  } else if (jitPressInterval == 0) {
+    jitPressInterval = UINT8_MAX;
+  }
+  jitSamplesSincePress = 0;
+  jitPressBaseline = jitSampleTomV(adcMeasurement);
+}
+
+void jit_checkpoint_begin(void) {
+  jitCheckpointStart = am_hal_stimer_counter_get();
+}
+
+void jit_checkpoint_end(void) {
+  uint32_t ticks = am_hal_stimer_counter_get() - jitCheckpointStart;
+  if (ticks > jitCheckpointTicks) {
+    // Be pessimistic, slow checkpoints are taken over immediately
+    jitCheckpointTicks = ticks;
+  } else {
+    jitCheckpointTicks -= (jitCheckpointTicks - ticks) / 8;
+  }
+
+  // Only forecast again after a fresh window of samples, a falling supply
+  // would trigger a checkpoint at every sample otherwise
+  jitHistoryHead = 0;
+  jitHistoryCount = 0;
+}
+
+int32_t jit_voltage_slope(void) { return jitSlope; }
+
+uint32_t jit_time_to_brownout(void) { return jitTimeToBrownout; }
+#else
+void jit_button_event(void) {
+  if (jitHibernating) {
+    jit_wakeup = true;
+  }
+}
+void jit_checkpoint_begin(void) {}
+void jit_checkpoint_end(void) {}
+int32_t jit_voltage_slope(void) { return 0; }
+uint32_t jit_time_to_brownout(void) { return UINT32_MAX; }
+#endif
+
 void am_adc_isr(void) {
   uint32_t ui32IntMask;
   am_hal_adc_sample_t Sample;
@@ -49,18 +239,44 @@ void am_adc_isr(void) {
   // Clear the ADC interrupt.
   am_hal_adc_interrupt_clear(g_ADCHandle, ui32IntMask);
 
+  if (ui32IntMask & AM_HAL_ADC_INT_CNVCMP) {
+    uint32_t ui32NumSamples = 1;
+    am_hal_adc_samples_read(g_ADCHandle, false, NULL, &ui32NumSamples, &Sample);
+    adcMeasurement = Sample.ui32Sample;
+  }
+  if (jitHibernating) {
+    if (ui32IntMask & AM_HAL_ADC_INT_WCEXC) {
+      // Above the wake-up threshold
+      jit_wakeup = true;
+    }
+    return;
+  }
+  if (ui32IntMask & AM_HAL_ADC_INT_CNVCMP) {
+#if JIT_FORECAST
+    if (forecast(jitSampleTomV(adcMeasurement))) {
+      jit_checkpoint = JIT_TRIGGER_FORECAST;
+#if JIT_ADC_DEBUG
+      am_util_stdio_printf("[jit] Forecast %d ms\n", jitTimeToBrownout);
+#endif
+    }
+#endif
+  }
   if (ui32IntMask & AM_HAL_ADC_INT_WCEXC) {
+#if JIT_FORECAST
+    // Below the threshold but charging, no need to checkpoint yet
+    if (jitHistoryCount == JIT_HISTORY_LENGTH &&
+        jitSlope > JIT_CHARGING_SLOPE) {
+      return;
+    }
+#endif
     // Outside of window, trigger jit
-    jit_checkpoint = 1;
+    if (jit_checkpoint == JIT_TRIGGER_NONE) {
+      jit_checkpoint = JIT_TRIGGER_THRESHOLD;
+    }
 #if JIT_ADC_DEBUG
     am_util_stdio_printf("[jit] Triggered\n");
 #endif
   }
-  if (ui32IntMask & AM_HAL_ADC_INT_CNVCMP) {
-    uint32_t ui32NumSamples = 1;
-    am_hal_adc_samples_read(g_ADCHandle, false, NULL, &ui32NumSamples, &Sample);
-    adcMeasurement = Sample.ui32Sample;
-  }
 }
 
 static void adc_config(void) {
@@ -142,24 +358,20 @@ static void enableAdcInterrupts(void) {
   am_hal_interrupt_master_enable();
 }
 
-#define AdcTimer 3
-#define ComTimerClkSource AM_HAL_CTIMER_HFRC_12KHZ
-#define PERIOD 10
-#define NUM_PULSES_PERIOD ((12000 / (PERIOD * 2)) - 1)
+static void jitTimerConfig(uint32_t clockSource, uint32_t period) {
+  am_hal_ctimer_stop(AdcTimer, AM_HAL_CTIMER_TIMERA);
 
-void jitTimerInit() {
   //
   // Configure a timer to drive the LED.
   //
   am_hal_ctimer_config_single(
       AdcTimer, AM_HAL_CTIMER_TIMERA,
-      (AM_HAL_CTIMER_FN_REPEAT | ComTimerClkSource | AM_HAL_CTIMER_ADC_TRIG));
+      (AM_HAL_CTIMER_FN_REPEAT | clockSource | AM_HAL_CTIMER_ADC_TRIG));
 
   //
   // Set up initial timer periods.
   //
-  am_hal_ctimer_period_set(AdcTimer, AM_HAL_CTIMER_TIMERA, NUM_PULSES_PERIOD,
-                           0);
+  am_hal_ctimer_period_set(AdcTimer, AM_HAL_CTIMER_TIMERA, period, 0);
 
   //
   // Start the timer.
@@ -167,12 +379,61 @@ void jitTimerInit() {
   am_hal_ctimer_start(AdcTimer, AM_HAL_CTIMER_TIMERA);
 }
 
+void jitTimerInit() { jitTimerConfig(ComTimerClkSource, NUM_PULSES_PERIOD); }
+
+static void adcWindowConfig(uint32_t lower, uint32_t upper) {
+  am_hal_adc_window_config_t ADCWindowConfig = {
+      .bScaleLimits = false, .ui32Upper = upper, .ui32Lower = lower};
+
+  am_hal_adc_disable(g_ADCHandle);
+  am_hal_adc_control(g_ADCHandle, AM_HAL_ADC_REQ_WINDOW_CONFIG,
+                     &ADCWindowConfig);
+  am_hal_adc_enable(g_ADCHandle);
+}
+
+/*
+ * Keep sampling at a low rate from the LFRC (it keeps running in deep sleep),
+ * and wake up when the voltage is above wakemV.
+ */
+void jit_hibernate(uint32_t wakemV) {
+  jit_wakeup = false;
+  jitHibernating = true;
+
+  // Inverted window, only a recovered voltage is outside of it
+  adcWindowConfig(0, jitmVToSample(wakemV));
+  jitTimerConfig(JIT_TIMER_CLOCK, JIT_TIMER_PERIOD);
+}
+
+void jit_resume(void) {
+  jitHibernating = false;
+
+  adcWindowConfig(jitTriggerThreshold, 0xFFFFF);
+  jitTimerInit();
+
+#if JIT_FORECAST
+  // The history was sampled at another rate
+  jitHistoryHead = 0;
+  jitHistoryCount = 0;
+#endif
+  jit_checkpoint = JIT_TRIGGER_NONE;
+}
+
 void jit_setup(void) {
   am_hal_gpio_pinconfig(JIT_ADC_PIN, g_AM_PIN_29_ADCSE1);
 
+#if JIT_FORECAST
+  // Checkpoint durations use the system timer, started at boot
+  jitHistoryHead = 0;
+  jitHistoryCount = 0;
+  jitSamplesSincePress = UINT8_MAX;
+  jitSlope = 0;
+  jitTimeToBrownout = UINT32_MAX;
+#endif
+
+  jitHibernating = false;
   jitTimerInit();
   adc_config();
   enableAdcInterrupts();
-  jit_checkpoint = 0;
+  jit_checkpoint = JIT_TRIGGER_NONE;
   triggerAdc();  // first trigger needs to be in software next is all done in hw
 }
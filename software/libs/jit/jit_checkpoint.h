@@ -12,7 +12,8 @@
 #include "emulator_settings.h"
 #include "platform.h"
 
-#define jitTriggerThreshold ((jitTriggermV * 1024) / 557) << 6
+#define jitmVToSample(mV) ((((mV)*1024) / 557) << 6)
+#define jitTriggerThreshold jitmVToSample(jitTriggermV)
 
 #define JIT_ADC_DEBUG 0
 #define ADC_SAMPLE_RATE 32
@@ -25,10 +26,37 @@
 
 #define JIT_COMPARE 42000
 
-// The JIT flag, becomes 1 when we need to checkpoint
+// Convert an ADC sample (14 bit, as read by am_hal_adc_samples_read) back to
+// the units of jitTriggermV. The window limits above are 14.6 fixed point.
+#define jitSampleTomV(sample) (((uint32_t)(sample)*557) / 1024)
+
+// Number of voltage samples used for the slope estimate
+#define JIT_HISTORY_LENGTH 8
+
+// Samples after a button press used to learn the harvested energy
+#define JIT_PRESS_WINDOW 4
+
+// Reasons for the JIT flag
+#define JIT_TRIGGER_NONE 0
+#define JIT_TRIGGER_THRESHOLD 1  // below the window comparator
+#define JIT_TRIGGER_FORECAST 2   // brownout expected before a checkpoint ends
+
+// The JIT flag, becomes non-zero (JIT_TRIGGER_*) when we need to checkpoint
 extern volatile char jit_checkpoint;
 extern volatile uint16_t adcMeasurement;
 
 void jit_setup(void);
 
+// Hibernation, jit_wakeup becomes true on a button press or recovered voltage
+extern volatile bool jit_wakeup;
+void jit_hibernate(uint32_t wakemV);
+void jit_resume(void);
+
+// Energy forecasting
+void jit_button_event(void);
+void jit_checkpoint_begin(void);
+void jit_checkpoint_end(void);
+int32_t jit_voltage_slope(void);  // in mV/s
+uint32_t jit_time_to_brownout(void);  // in ms, UINT32_MAX when not draining
+
 #endif /* JIT_CHECKPOINT_H_ */
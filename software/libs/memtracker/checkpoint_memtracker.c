@@ -20,6 +20,10 @@
 
 #endif
 
+// Regions needed to draw the next frame: VRAM (0x8000-0x9FFF) and
+// OAM/IO/HRAM (0xF000-0xFFFF)
+#define PRIORITY_REGIONS ((1 << 0) | (1 << 1) | (1 << 7))
+
 size_t setup_memtracker(void) {
   initTracking(z80.memory);
   return 0;
@@ -74,3 +78,30 @@ size_t post_checkpoint_memtracker(void) {
 
   return 0;
 }
+
+#if LAZY_RESTORE && defined(MPATCH_CP_MEMTRACKER)
+static void restore_memtracker_region(uint32_t start, uint32_t end) {
+  mpatch_apply_range((mpatch_addr_t)start, (mpatch_addr_t)end);
+}
+
+/*
+ * Restore the priority regions, the others are restored on their first
+ * access (see memTrackingHandler) or in the background.
+ * Requires restore_mpatch_deferred() instead of restore_mpatch()
+ */
+size_t restore_memtracker(void) {
+  startAddress = ((uint32_t)z80.memory) & ~REGIONMASK;
+
+  for (uint8_t i = 0; i < NUM_MPU_REGIONS; i++) {
+    if (PRIORITY_REGIONS & (1 << i)) {
+      restore_memtracker_region(startAddress + i * REGIONSIZE_BYTES,
+                                startAddress + (i + 1) * REGIONSIZE_BYTES - 1);
+    }
+  }
+
+  // Protected by initTracking() after the restore
+  setLazyRegions((uint8_t)~PRIORITY_REGIONS, restore_memtracker_region);
+
+  return 0;
+}
+#endif
@@ -11,12 +11,17 @@
 
 #include <stdlib.h>
 
+#include "emulator_settings.h"
+
 size_t setup_memtracker(void);
 size_t checkpoint_memtracker(void);
 
-/* Restore is handled by MPatch */
-// size_t restore_memtracker(void);
+/* Restore is handled by MPatch, in order of priority with LAZY_RESTORE */
+#if LAZY_RESTORE
+size_t restore_memtracker(void);
+#else
 #define restore_memtracker()
+#endif
 
 size_t post_checkpoint_memtracker(void);
 
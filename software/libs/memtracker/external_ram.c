@@ -0,0 +1,251 @@
+/*
+ * external_ram.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "external_ram.h"
+
+#if EXTERNAL_RAM
+#include <string.h>
+
+#include "am_util.h"
+#include "platform.h"
+#include "reader.h"
+
+#ifdef CHECKPOINT
+#include "mpatch.h"
+#include "nvm.h"
+
+#define MPATCH_CP_EXTERNAL_RAM
+
+#if ROM_LIBRARY
+// Set while the checkpoint holds RAM that is not on the cartridge, outside of
+// the checkpoint so it can be read before a restore
+static nvm volatile uint32_t checkpointUnsaved;
+#endif
+#endif
+
+// Checkpointed in its own MPatch chain instead of with the .bss
+CHECKPOINT_EXCLUDE_BSS
+uint8_t externalRam[ExternalRamSize] __attribute__((aligned(4)));
+CHECKPOINT_EXCLUDE_BSS
+uint32_t externalRamDirty[ExternalRamDirtyWords];
+
+uint8_t* externalRamBank = externalRam;
+uint16_t externalRamMask = ExternalRamBankSize - 1;
+void (*externalRamRegisterWrite)(uint8_t value);
+uint8_t externalRamEnabled;
+uint8_t externalRamBanking;
+static uint8_t externalRamRequested;  // by the game, enabled if mapped
+static uint8_t externalRamBankNr;
+static uint32_t externalRamSize;  // of the game, up to ExternalRamSize
+
+#if EXTERNAL_RAM_WRITEBACK
+// Blocks that are not yet written back to the cartridge
+uint32_t externalRamUnsaved[ExternalRamDirtyWords];
+#endif
+
+static uint8_t blockSet(const uint32_t* blocks, uint32_t block) {
+  return (blocks[block / 32] >> (block % 32)) & 1;
+}
+
+static void mapBank(void) {
+  uint32_t banks = externalRamSize / ExternalRamBankSize;
+  uint8_t bank = externalRamBanking ? externalRamBankNr : 0;
+
+  if (banks > 1) {
+    bank %= banks;
+  } else {
+    bank = 0;
+  }
+  externalRamBank = &externalRam[bank * ExternalRamBankSize];
+  externalRamMask = (externalRamSize && externalRamSize < ExternalRamBankSize)
+                        ? externalRamSize - 1
+                        : ExternalRamBankSize - 1;
+  externalRamRegisterWrite = NULL;
+  externalRamEnabled = externalRamRequested && externalRamSize;
+}
+
+#if EXTERNAL_RAM_WRITEBACK
+/*
+ * Writes the blocks changed since the last write-back to the cartridge. A
+ * block stays marked until it is written, so blocks that were cut off by a
+ * power failure (or without the cartridge) are written with the next save.
+ */
+static void writeBack(void) {
+  uint32_t blocks = externalRamSize / ExternalRamBlockSize;
+
+  for (uint32_t block = 0; block < blocks; block++) {
+    if (!blockSet(externalRamUnsaved, block)) {
+      continue;
+    }
+    if (!cartridgeConnect()) {
+      return;
+    }
+
+    uint32_t offset = block * ExternalRamBlockSize;
+    if (cartridgeWriteRam(offset, &externalRam[offset],
+                          ExternalRamBlockSize)) {
+      externalRamUnsaved[block / 32] &= ~(1UL << (block % 32));
+    }
+  }
+}
+#endif
+
+void externalRamEnable(uint8_t enable) {
+#if EXTERNAL_RAM_WRITEBACK
+  if (externalRamRequested && !enable) {
+    // Games disable the RAM once a save is written
+    writeBack();
+  }
+#endif
+  externalRamRequested = enable;
+  externalRamEnabled =
+      enable && (externalRamSize || externalRamRegisterWrite != NULL);
+}
+
+void externalRamBankingMode(uint8_t banking) {
+  externalRamBanking = banking;
+  mapBank();
+}
+
+void externalRamSelectBank(uint8_t bank) {
+  externalRamBankNr = bank;
+  mapBank();
+}
+
+void externalRamMapRegister(uint8_t* reg, void (*write)(uint8_t value)) {
+  externalRamBank = reg;
+  externalRamMask = 0;
+  externalRamRegisterWrite = write;
+  externalRamEnabled = externalRamRequested;
+}
+
+void externalRamReset(uint32_t size) {
+  externalRamSize = size;
+  if (externalRamSize > ExternalRamSize) {
+    am_util_stdio_printf(
+        "Cartridge RAM too big, increase EXTERNAL_RAM_BANKS\n");
+    externalRamSize = ExternalRamSize;
+  }
+
+  externalRamRequested = 0;
+  externalRamBanking = 0;
+  externalRamBankNr = 0;
+  mapBank();
+}
+
+uint32_t externalRamSizeBytes(void) { return externalRamSize; }
+
+void externalRamImport(void) {
+  if (!externalRamSize || !cartridgeConnect()) {
+    return;
+  }
+
+  am_util_stdio_printf("Reading cartridge RAM (%d bytes)\n", externalRamSize);
+  cartridgeReadRam(0, externalRam, externalRamSize);
+#if EXTERNAL_RAM_WRITEBACK
+  memset(externalRamUnsaved, 0, sizeof(externalRamUnsaved));
+#endif
+}
+
+#if defined(CHECKPOINT) && ROM_LIBRARY
+uint8_t externalRamCheckpointUnsaved(void) { return checkpointUnsaved != 0; }
+#endif
+
+static void setCheckpointUnsaved(uint32_t unsaved) {
+#if defined(CHECKPOINT) && ROM_LIBRARY
+  // Written while staging, before the checkpoint with the blocks commits
+  if (checkpointUnsaved != unsaved) {
+    checkpointUnsaved = unsaved;
+  }
+#endif
+}
+
+// Stages the blocks [first,last] as one patch
+static void stageBlocks(uint32_t first, uint32_t last) {
+#ifdef MPATCH_CP_EXTERNAL_RAM
+  mpatch_addr_t start =
+      (mpatch_addr_t)&externalRam[first * ExternalRamBlockSize];
+  mpatch_addr_t end =
+      (mpatch_addr_t)&externalRam[(last + 1) * ExternalRamBlockSize] - 1;
+
+  mpatch_pending_patch_t pp;
+  mpatch_new_region(&pp, start, end, MPATCH_STANDALONE);
+  mpatch_stage_patch_retry(MPATCH_EXTERNAL_RAM, &pp);
+#endif
+}
+
+/*
+ * At the start make a checkpoint of the whole RAM of the game
+ */
+void checkpoint_external_ram_default(void) {
+  uint32_t blocks = externalRamSize / ExternalRamBlockSize;
+
+  // Imported from the cartridge (or empty)
+  setCheckpointUnsaved(0);
+
+  if (blocks) {
+    stageBlocks(0, blocks - 1);
+  }
+}
+
+/*
+ * Checkpoint the blocks that have been written to, consecutive blocks in a
+ * single patch
+ */
+size_t checkpoint_external_ram(void) {
+  uint32_t blocks = externalRamSize / ExternalRamBlockSize;
+
+  for (uint32_t block = 0; block < blocks; block++) {
+    if (!blockSet(externalRamDirty, block)) {
+      continue;
+    }
+
+    uint32_t last = block;
+    while (last + 1 < blocks && blockSet(externalRamDirty, last + 1)) {
+      last++;
+    }
+    stageBlocks(block, last);
+    block = last;
+#if !EXTERNAL_RAM_WRITEBACK
+    // Only the checkpoint will hold the written blocks
+    setCheckpointUnsaved(1);
+#endif
+  }
+
+#if EXTERNAL_RAM_WRITEBACK
+  uint32_t unsaved = 0;
+  for (uint32_t word = 0; word < ExternalRamDirtyWords; word++) {
+    unsaved |= externalRamUnsaved[word];
+  }
+  setCheckpointUnsaved(unsaved != 0);
+#endif
+
+  return 0;
+}
+
+size_t post_checkpoint_external_ram(void) {
+  memset(externalRamDirty, 0, sizeof(externalRamDirty));
+  return 0;
+}
+
+#if LAZY_RESTORE
+/*
+ * The deferred MPatch restore leaves the RAM to the application, it is
+ * restored at once (the .bss with the size is restored before)
+ */
+size_t restore_external_ram(void) {
+#ifdef MPATCH_CP_EXTERNAL_RAM
+  if (externalRamSize) {
+    mpatch_apply_range((mpatch_addr_t)externalRam,
+                       (mpatch_addr_t)&externalRam[externalRamSize - 1]);
+  }
+#endif
+  return 0;
+}
+#endif
+#endif
@@ -0,0 +1,97 @@
+/*
+ * external_ram.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef LIBS_MEMTRACKER_EXTERNAL_RAM_H_
+#define LIBS_MEMTRACKER_EXTERNAL_RAM_H_
+
+#include <stdlib.h>
+
+#include "am_mcu_apollo.h"
+#include "emulator_settings.h"
+
+#if EXTERNAL_RAM
+#define ExternalRamBankSize 0x2000  // mapped at 0xA000..0xBFFF
+#define ExternalRamSize (EXTERNAL_RAM_BANKS * ExternalRamBankSize)
+
+// Blocks written since the last checkpoint are staged in the MPatch chain
+#define ExternalRamBlockSize 512
+#define ExternalRamBlocks (ExternalRamSize / ExternalRamBlockSize)
+#define ExternalRamDirtyWords ((ExternalRamBlocks + 31) / 32)
+
+extern uint8_t externalRam[ExternalRamSize];
+extern uint8_t* externalRamBank;  // the bank that is mapped
+extern uint16_t externalRamMask;  // smaller RAM is mirrored in the bank
+extern void (*externalRamRegisterWrite)(uint8_t value);
+extern uint8_t externalRamEnabled;
+extern uint8_t externalRamBanking;  // MBC1 mode 1 (ram banking)
+extern uint32_t externalRamDirty[ExternalRamDirtyWords];
+#if EXTERNAL_RAM_WRITEBACK
+extern uint32_t externalRamUnsaved[ExternalRamDirtyWords];
+#endif
+
+// Called by the emulator for 0xA000..0xBFFF, offset from 0xA000
+__attribute__((always_inline))
+static inline uint8_t externalRamRead(uint16_t offset) {
+  if (!externalRamEnabled) {
+    return 0xFF;
+  }
+  return externalRamBank[offset & externalRamMask];
+}
+
+__attribute__((always_inline))
+static inline void externalRamWrite(uint16_t offset, uint8_t value) {
+  if (!externalRamEnabled) {
+    return;
+  }
+  if (externalRamRegisterWrite) {
+    externalRamRegisterWrite(value);
+    return;
+  }
+  uint32_t index =
+      (externalRamBank - externalRam) + (offset & externalRamMask);
+  uint32_t block = index / ExternalRamBlockSize;
+  externalRam[index] = value;
+  externalRamDirty[block / 32] |= 1UL << (block % 32);
+#if EXTERNAL_RAM_WRITEBACK
+  externalRamUnsaved[block / 32] |= 1UL << (block % 32);
+#endif
+}
+
+// Memory bank controller registers
+void externalRamEnable(uint8_t enable);
+void externalRamBankingMode(uint8_t banking);
+void externalRamSelectBank(uint8_t bank);
+// Maps a controller register (MBC3 clock) instead of a bank
+void externalRamMapRegister(uint8_t* reg, void (*write)(uint8_t value));
+
+// Maps bank 0 of a RAM of size bytes
+void externalRamReset(uint32_t size);
+uint32_t externalRamSizeBytes(void);
+
+// Reads the RAM of the inserted cartridge, if it belongs to the ROM
+void externalRamImport(void);
+
+#if defined(CHECKPOINT) && ROM_LIBRARY
+// The checkpoint holds RAM that is not on the cartridge (the only copy of the
+// save), valid before the restore
+uint8_t externalRamCheckpointUnsaved(void);
+#endif
+
+size_t checkpoint_external_ram(void);
+void checkpoint_external_ram_default(void);
+size_t post_checkpoint_external_ram(void);
+
+/* Restore is handled by MPatch, on its own with LAZY_RESTORE */
+#if LAZY_RESTORE
+size_t restore_external_ram(void);
+#else
+#define restore_external_ram()
+#endif
+#endif
+
+#endif /* LIBS_MEMTRACKER_EXTERNAL_RAM_H_ */
@@ -18,6 +18,13 @@ uint32_t regionTracker[NUM_MPU_TOTAL_REGIONS];
 
 uint32_t startAddress;
 
+// Regions that still have to be restored, no access allowed until then
+CHECKPOINT_EXCLUDE_BSS
+volatile uint8_t lazyRegions;
+
+CHECKPOINT_EXCLUDE_BSS
+RegionRestoreFunctionPtr lazyRestoreFunction;
+
 #ifdef TRACKING_COUNT_WRITES
 typedef void (*CompleteWriteFunctionPtr)(uint32_t stackptr);
 
@@ -80,9 +87,15 @@ void initTracking(uint8_t* z80RamPtr) {
   for (uint8_t i = 0; i < NUM_MPU_REGIONS; i++) {
     // register the region to the fraction of the memory size
     MPU->RBAR = ARM_MPU_RBAR(i, regionAddress);
-    // enable all subregions and set to read only, i.e. writes trigger
-    // MemManage_Handler.
-    MPU->RASR = ARM_MPU_RASR(0, ARM_MPU_AP_RO, 0, 0, 1, 1, 0x00, REGIONSIZE);
+    if (lazyRegions & (1 << i)) {
+      // not restored yet, any access triggers MemManage_Handler.
+      MPU->RASR =
+          ARM_MPU_RASR(0, ARM_MPU_AP_NONE, 0, 0, 1, 1, 0x00, REGIONSIZE);
+    } else {
+      // enable all subregions and set to read only, i.e. writes trigger
+      // MemManage_Handler.
+      MPU->RASR = ARM_MPU_RASR(0, ARM_MPU_AP_RO, 0, 0, 1, 1, 0x00, REGIONSIZE);
+    }
     regionAddress += (2 << REGIONSIZE);
   }
 
@@ -102,7 +115,36 @@ void initTracking(uint8_t* z80RamPtr) {
 #endif
 }
 
-void memTrackingHandler(uint32_t stackptr) {
+void setLazyRegions(uint8_t regions, RegionRestoreFunctionPtr restoreFunc) {
+  lazyRestoreFunction = restoreFunc;
+  lazyRegions = regions;
+}
+
+// Restore a lazy region and make it tracked (read only) again.
+static void restoreLazyRegion(uint8_t region) {
+  uint32_t regionstart = startAddress + region * REGIONSIZE_BYTES;
+
+  // Background map (read/write) while restoring
+  MPU->RNR = region;
+  MPU->RASR &= ~MPU_RASR_ENABLE_Msk;
+
+  lazyRestoreFunction(regionstart, regionstart + (REGIONSIZE_BYTES - 1));
+  lazyRegions &= ~(1 << region);
+
+  MPU->RASR = ARM_MPU_RASR(0, ARM_MPU_AP_RO, 0, 0, 1, 1, 0x00, REGIONSIZE);
+  __DSB();
+  __ISB();
+}
+
+void restoreNextLazyRegion(void) {
+  uint32_t primask = am_hal_interrupt_master_disable();
+  if (lazyRegions) {
+    restoreLazyRegion(__builtin_ctz(lazyRegions));
+  }
+  am_hal_interrupt_master_set(primask);
+}
+
+RAMFUNC void memTrackingHandler(uint32_t stackptr) {
   // get the address causing the issue MIGHT BE INVALID!
   uint32_t address = SCB->MMFAR;
   address -= startAddress;
@@ -111,6 +153,14 @@ void memTrackingHandler(uint32_t stackptr) {
     // Reset CFSR otherwise MMFAR remains the same.
     SCB->CFSR |= SCB->CFSR;
 
+    // First access to a region that is not restored yet, restore it and
+    // retry the access. A write faults again and is tracked as usual.
+    uint8_t region = address / REGIONSIZE_BYTES;
+    if (region < NUM_MPU_REGIONS && (lazyRegions & (1 << region))) {
+      restoreLazyRegion(region);
+      return;
+    }
+
     // Apply mask to get the subregion that triggered the handler.
     address &= ~SUBREGIONMASK;
     // Retrieve the region.
@@ -141,7 +191,7 @@ void memTrackingHandler(uint32_t stackptr) {
   }
 }
 
-void __attribute__((naked)) MemManage_Handler(void) {
+RAMFUNC void __attribute__((naked)) MemManage_Handler(void) {
   __asm(" push    {r0,lr}");
   __asm(" tst     lr, #4");
   __asm(" itet    eq");
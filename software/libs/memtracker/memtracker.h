@@ -24,9 +24,18 @@
 #define REGIONSIZE_BYTES (2UL << REGIONSIZE)
 #define SUB_REGIONSIZE_BYTES (2UL << SUBREGIONSIZE)
 
+typedef void (*RegionRestoreFunctionPtr)(uint32_t start, uint32_t end);
+
 extern uint32_t startAddress;
 extern uint32_t regionTracker[NUM_MPU_TOTAL_REGIONS];
+extern volatile uint8_t lazyRegions;
 
 void initTracking(uint8_t* z80RamPtr);
 
+// Mark regions (bitmask) as not restored, they are restored with restoreFunc
+// on their first access. Takes effect at the next initTracking().
+void setLazyRegions(uint8_t regions, RegionRestoreFunctionPtr restoreFunc);
+// Restore the lowest region that is not yet restored
+void restoreNextLazyRegion(void);
+
 #endif /* LIBS_MEMTRACKER_MEMTRACKER_H_ */
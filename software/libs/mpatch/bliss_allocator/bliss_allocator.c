@@ -309,7 +309,7 @@ void bliss_extract_woffset(char *dst, void *bliss_lst, size_t offset, size_t n)
     }
 
     /* Copy the first block */
-    bliss_memcpy(dst, &bliss_list->data[first_block_offset], copy_first_block);
+    bliss_extract_memcpy(dst, &bliss_list->data[first_block_offset], copy_first_block);
     bliss_list = bliss_i2a(bliss_list->next_block);
     dst = &dst[copy_first_block];
 
@@ -319,14 +319,14 @@ void bliss_extract_woffset(char *dst, void *bliss_lst, size_t offset, size_t n)
 
     /* Fill the first 1 - n_blocks-1 */
     for (int i=1; i<n_blocks-1; i++) {
-        bliss_memcpy(dst, bliss_list->data, BLISS_BLOCK_DATA_SIZE);
+        bliss_extract_memcpy(dst, bliss_list->data, BLISS_BLOCK_DATA_SIZE);
         bliss_list = bliss_i2a(bliss_list->next_block);
         dst = &dst[BLISS_BLOCK_DATA_SIZE]; // Move the dst pointer
     }
 
     copy_last_block = (n + first_block_offset) % BLISS_BLOCK_DATA_SIZE;
     /* Copy the remaining data into the last block */
-    bliss_memcpy(dst, bliss_list->data, copy_last_block);
+    bliss_extract_memcpy(dst, bliss_list->data, copy_last_block);
 }
 
 /**
@@ -27,4 +27,17 @@ extern uint32_t _ebliss; // Defined in linker script
 #include <string.h>
 #define bliss_memcpy memcpy
 
+/**
+ * The memcpy that is used by bliss to extract blocks, the data is only
+ * valid after bliss_extract_sync()
+ */
+#ifdef CHECKPOINT_RESTORE_DMA
+#include "fram.h"
+#define bliss_extract_memcpy framReadQueue
+#define bliss_extract_sync framReadFlush
+#else
+#define bliss_extract_memcpy bliss_memcpy
+#define bliss_extract_sync()
+#endif
+
 #endif /* BLISS_ALLOCATOR_CFG_H_ */
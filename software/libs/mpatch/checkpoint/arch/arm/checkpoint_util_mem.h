@@ -4,7 +4,14 @@
 #include <string.h>
 
 #define checkpoint_mem      memcpy
-#define restore_mem         memcpy
 #define checkpoint_memcpy   memcpy
 
+#ifdef CHECKPOINT_RESTORE_DMA
+/* Restore with DMA bulk reads instead of word by word over XIP */
+#include "fram.h"
+#define restore_mem         framRead
+#else
+#define restore_mem         memcpy
+#endif
+
 #endif /* CHECKPOINT_MEM_H_ */
@@ -18,6 +18,17 @@ size_t restore_mpatch(void)
     return 0;
 }
 
+/*
+ * Restore the MPatch state without applying the patches, the application is
+ * responsible to apply them (e.g., on demand with mpatch_apply_range())
+ */
+size_t restore_mpatch_deferred(void)
+{
+    mpatch_core_restore();
+    mpatch_recover();
+    return 0;
+}
+
 size_t setup_mpatch(void)
 {
     size_t blocks = mpatch_init();
@@ -6,6 +6,7 @@
 
 size_t checkpoint_mpatch(void);
 size_t restore_mpatch(void);
+size_t restore_mpatch_deferred(void);
 size_t setup_mpatch(void);
 
 #define post_checkpoint_mpatch mpatch_core_post_checkpoint
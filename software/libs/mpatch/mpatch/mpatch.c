@@ -579,6 +579,56 @@ void mpatch_apply_all(bool delete_obsolete)
         mpatch_origin_t *origin = mpatch_get_origin(id);
         mpatch_apply_patch_chain(origin, false, delete_obsolete, true);
     }
+
+    mpatch_extract_sync();
+}
+
+/*
+ * Apply the patches of a chain, but only the parts within [win_low,win_high].
+ * Nothing is freed or deleted, as the patches are still required for the
+ * memory outside of the window.
+ */
+static void mpatch_apply_patch_chain_range(mpatch_origin_t *origin, mpatch_addr_t win_low, mpatch_addr_t win_high)
+{
+    mpatch_patch_t *nvm_patch;
+
+    /* Reset the intervaltree */
+    it_root = NULL;
+
+    /* Skip the uncommitted patches, see mpatch_apply_patch_chain() */
+    nvm_patch = origin->patch_list;
+    mpatch_lclock_t local_lclock = mpatch_get_lclock();
+    while (nvm_patch != NULL && nvm_patch->stage_clock == local_lclock) {
+      nvm_patch = nvm_patch->next;
+    }
+
+    while (nvm_patch) {
+        mpatch_addr_t low = (nvm_patch->range.low > win_low) ? nvm_patch->range.low : win_low;
+        mpatch_addr_t high = (nvm_patch->range.high < win_high) ? nvm_patch->range.high : win_high;
+
+        if (low <= high) {
+            mpatch_range_t applied_range = {.low=0, .high=0};
+
+            if (mpatch_apply(nvm_patch, low, high, &applied_range, true)) {
+                DEBUG_PRINT("Inserting interval [%lx,%lx]\n", low, high);
+                it_root = intervaltree_insert_node(it_root, nvm_patch);
+            }
+        }
+
+        nvm_patch = nvm_patch->next;
+    }
+}
+
+/* Apply all the patches, limited to the range [low,high] */
+void mpatch_apply_range(mpatch_addr_t low, mpatch_addr_t high)
+{
+    for (mpatch_id_t id=MPATCH_FIRST_ID; id<MPATCH_LAST_ID; id++) {
+        DEBUG_PRINT("Applying patch chain: %d, range: [%lx,%lx]\n", id, low, high);
+        mpatch_origin_t *origin = mpatch_get_origin(id);
+        mpatch_apply_patch_chain_range(origin, low, high);
+    }
+
+    mpatch_extract_sync();
 }
 
 void mpatch_sweep_delete_obselete(void)
@@ -17,6 +17,7 @@ typedef enum mpatch_id {
     MPATCH_FIRST_ID = 0,
 
     MPATCH_GENERAL = 0,
+    MPATCH_EXTERNAL_RAM, // Emulated cartridge RAM, tracked on its own
 
     //MPATCH_C_STACK,
     //MPATCH_C_DATA,
@@ -152,6 +153,12 @@ void mpatch_restore_patches(void);
 
 void mpatch_apply_all(bool delete_obsolete);
 
+/**
+ * Apply the patches only for the memory in [low,high]
+ * Used to restore parts of the memory on demand
+ */
+void mpatch_apply_range(mpatch_addr_t low, mpatch_addr_t high);
+
 void mpatch_sweep_delete_obselete(void);
 
 
@@ -32,6 +32,7 @@ typedef uint8_t mpatch_lclock_t;     // The logical clock type, required for dou
 #define mpatch_store            bliss_store
 #define mpatch_extract          bliss_extract
 #define mpatch_extract_woffset  bliss_extract_woffset
+#define mpatch_extract_sync     bliss_extract_sync
 
 /**
  * Allocator intermittency handling calls
@@ -806,6 +806,68 @@ test(patch_overlap_modify_outside_lower)
             patch_2_low, patch_2_high);
 }
 
+test(patch_apply_range)
+{
+    const size_t patch_size = 100;
+    const size_t range_low = 20;
+    const size_t range_high = 59;
+
+    char *patch_content = malloc(patch_size);
+    char *patch_compare = malloc(patch_size);
+
+    for (int i=0; i<patch_size; i++) {
+        patch_content[i] = i;
+        patch_compare[i] = i;
+    }
+
+    mpatch_id_t id = MPATCH_FIRST_ID;
+    mpatch_pending_patch_t *patch = mpatch_get(id);
+    mpatch_new_region(patch,
+            (mpatch_addr_t)&patch_content[0],
+            (mpatch_addr_t)&patch_content[patch_size-1],
+            MPATCH_CONTINUOUS);
+    mpatch_enable(patch);
+
+    // Commit a checkpoint (stage and commit patches)
+    fake_checkpoint();
+
+    // Overlapping newer patch
+    for (int i=40; i<patch_size; i++) {
+        patch_content[i] += 10;
+        patch_compare[i] = patch_content[i];
+    }
+
+    fake_checkpoint();
+
+    // Scramble the patch content
+    for (int i=0; i<patch_size; i++) {
+        patch_content[i] += 2;
+    }
+
+    fake_powerfailure();
+    mpatch_apply_range((mpatch_addr_t)&patch_content[range_low],
+                       (mpatch_addr_t)&patch_content[range_high]);
+
+    // Only the range is restored
+    for (int i=0; i<patch_size; i++) {
+        if (i >= range_low && i <= range_high) {
+            assert_true(patch_content[i] == patch_compare[i]);
+        } else {
+            assert_true(patch_content[i] == (char)(patch_compare[i] + 2));
+        }
+    }
+
+    // The rest can still be restored afterwards
+    mpatch_apply_all(false);
+
+    for (int i=0; i<patch_size; i++) {
+        assert_true(patch_content[i] == patch_compare[i]);
+    }
+
+    free(patch_content);
+    free(patch_compare);
+}
+
 static void patch_obsolete_delete_check(void)
 {
     /* Delete tests: */
@@ -1687,6 +1749,7 @@ int main(void)
         mpatch_cmocka_unit_test(patch_overlap_total_overlap),
         mpatch_cmocka_unit_test(patch_overlap_modify_outside_higher),
         mpatch_cmocka_unit_test(patch_overlap_modify_outside_lower),
+        mpatch_cmocka_unit_test(patch_apply_range),
 
         /* Patch delete tests */
         mpatch_cmocka_unit_test(patch_obsolete_total_obsolete_inside),
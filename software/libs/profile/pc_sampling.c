@@ -0,0 +1,61 @@
+/*
+ * pc_sampling.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "pc_sampling.h"
+
+#if PC_SAMPLING
+#include "am_util.h"
+#include "platform.h"
+
+// Only valid for the current boot, so never restored
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t pcSamples[PcSamplingBuffer];
+CHECKPOINT_EXCLUDE_BSS
+static uint32_t pcSampleCount;
+
+void pcSamplingStart(void) {
+  pcSampleCount = 0;
+  SysTick_Config(PC_SAMPLING_PERIOD);
+}
+
+/*
+ * The SysTick is stopped while the samples are printed, so the time spent
+ * printing does not show up in the profile.
+ */
+static void pcSamplingReport(void) {
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+  for (uint32_t i = 0; i < PcSamplingBuffer; i += PcSamplingPerLine) {
+    am_util_stdio_printf("[pc]");
+    for (uint32_t n = i; n < i + PcSamplingPerLine; n++) {
+      am_util_stdio_printf(" %08x", pcSamples[n]);
+    }
+    am_util_stdio_printf("\n");
+  }
+  pcSampleCount = 0;
+
+  SysTick->VAL = 0;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+}
+
+void pcSamplingRecord(uint32_t* stackptr) {
+  // Exception frame: r0-r3, r12, lr, pc, xpsr
+  pcSamples[pcSampleCount++] = stackptr[6];
+  if (pcSampleCount == PcSamplingBuffer) {
+    pcSamplingReport();
+  }
+}
+
+void __attribute__((naked)) SysTick_Handler(void) {
+  __asm(" tst     lr, #4");
+  __asm(" ite     eq");
+  __asm(" mrseq   r0, msp");
+  __asm(" mrsne   r0, psp");
+  __asm(" b       pcSamplingRecord");
+}
+#endif
@@ -0,0 +1,24 @@
+/*
+ * pc_sampling.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef LIBS_PROFILE_PC_SAMPLING_H_
+#define LIBS_PROFILE_PC_SAMPLING_H_
+
+#include "am_mcu_apollo.h"
+#include "emulator_settings.h"
+
+#if PC_SAMPLING
+#define PcSamplingBuffer 256  // samples printed at once
+#define PcSamplingPerLine 8
+
+// Samples the interrupted PC with the SysTick, the samples are printed as
+// "[pc] <hex> ..." lines for scripts/hot_functions.py
+void pcSamplingStart(void);
+#endif
+
+#endif /* LIBS_PROFILE_PC_SAMPLING_H_ */
@@ -35,4 +35,7 @@
 #define CHECKPOINT_EXCLUDE_BSS
 #endif
 
+// Runs from SRAM, copied at startup (see .ramfunc in the linker script)
+#define RAMFUNC __attribute__((section(".ramfunc")))
+
 #endif /* PLATFORMS_PLATFORM_H_ */
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Picks the functions that run from SRAM out of a PC sampling profile.
+#
+# Build with PC_SAMPLING 1, play for a while and capture the UART output
+# ("[pc] <hex> ..." lines). The samples are attributed to the functions of the
+# same build, the hottest ones that fit in the budget are written as a linker
+# script fragment (config/hot_functions.ld) for the .ramfunc section.
+#
+#   scripts/hot_functions.py bin/emulator.elf uart.log
+#
+# Author: TU Delft Sustainable Systems Laboratory
+# License: MIT License
+
+import argparse
+import bisect
+import subprocess
+import sys
+
+# Run before the functions are copied, or are already placed by name
+EXCLUDE = {"Reset_Handler", "am_default_isr"}
+# Placed with a section attribute, have no .text.<name> section to match
+EXCLUDE |= {"z80_single_step", "memTrackingHandler", "MemManage_Handler"}
+
+
+def read_functions(nm, elf):
+    """Returns [(address, size, name)] of the functions, sorted by address"""
+    out = subprocess.run([nm, "--print-size", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    functions = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) != 4 or fields[2] not in "tT":
+            continue
+        # Thumb functions have bit 0 set
+        address = int(fields[0], 16) & ~1
+        functions.append((address, int(fields[1], 16), fields[3]))
+    functions.sort()
+    return functions
+
+
+def read_samples(log):
+    samples = []
+    for line in log:
+        if not line.startswith("[pc]"):
+            continue
+        for word in line.split()[1:]:
+            try:
+                samples.append(int(word, 16) & ~1)
+            except ValueError:
+                break  # cut off line
+    return samples
+
+
+def profile(functions, samples):
+    """Returns {name: [samples, size]} and the number of unattributed samples"""
+    starts = [f[0] for f in functions]
+    hits = {}
+    missed = 0
+    for pc in samples:
+        i = bisect.bisect_right(starts, pc) - 1
+        if i < 0 or pc >= functions[i][0] + functions[i][1]:
+            missed += 1
+            continue
+        name, size = functions[i][2], functions[i][1]
+        hits.setdefault(name, [0, size])[0] += 1
+    return hits, missed
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Pick the functions that run from SRAM")
+    parser.add_argument("elf", help="firmware that produced the samples")
+    parser.add_argument("log", help="UART output with the [pc] lines")
+    parser.add_argument("-o", "--output", default="config/hot_functions.ld")
+    parser.add_argument("-b", "--budget", type=int, default=40 * 1024,
+                        help="bytes of SRAM for code (RFMEM in apollo3.ld)")
+    parser.add_argument("-m", "--min-share", type=float, default=0.5,
+                        help="ignore functions below this share (in %%)")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    args = parser.parse_args()
+
+    functions = read_functions(args.nm, args.elf)
+    with open(args.log, errors="replace") as log:
+        samples = read_samples(log)
+    if not samples:
+        sys.exit("No [pc] samples in " + args.log)
+
+    hits, missed = profile(functions, samples)
+
+    # Most samples per byte first, SRAM is the scarce part
+    ranked = sorted(hits.items(), key=lambda h: h[1][0] / max(h[1][1], 1),
+                    reverse=True)
+    used = 0
+    covered = 0
+    lines = []
+    for name, (count, size) in ranked:
+        share = 100.0 * count / len(samples)
+        if name in EXCLUDE or share < args.min_share:
+            continue
+        if used + size > args.budget:
+            continue
+        used += size
+        covered += count
+        lines.append("*(.text.%s) /* %.1f%%, %d bytes */\n" %
+                     (name, share, size))
+
+    with open(args.output, "w") as out:
+        out.write("/*\n")
+        out.write(" * Functions placed in SRAM (see .ramfunc), one pattern "
+                  "per function.\n")
+        out.write(" * Generated by scripts/hot_functions.py from %d PC "
+                  "samples.\n" % len(samples))
+        out.write(" */\n")
+        out.writelines(lines)
+
+    print("%d functions, %d bytes, %.1f%% of the samples (%d outside the "
+          "functions)" % (len(lines), used, 100.0 * covered / len(samples),
+                          missed))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,37 @@
+/*
+ * gameboy_ub.h
+ *
+ * Mock of the timer and LCD state the batch execution reads.
+ *
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef GAMEBOY_UB_H_
+#define GAMEBOY_UB_H_
+
+#include "z80_ub.h"
+
+#define LCD_MODE2_CYCLES 80
+#define LCD_MODE3_CYCLES 172
+#define LCD_MODE0_CYCLES 204
+#define LCD_LINE_CYCLES 456
+#define DIV_COUNTER_CYCLES 256
+
+#define TAC_ADR 0xFF07
+#define IF_ADR 0xFF0F
+#define LCDC_ADR 0xFF40
+#define IE_ADR 0xFFFF
+
+typedef struct {
+  uint32_t mcu_cycl_cnt;
+  uint32_t div_cycl_cnt;
+  uint8_t tim_enable;
+  uint32_t tim_cycl_ovf;
+  uint32_t tim_cycl_cnt;
+  uint8_t lcd_mode;
+} Shadow_t;
+
+extern Shadow_t Shadow;
+
+#endif /* GAMEBOY_UB_H_ */
@@ -0,0 +1,149 @@
+/*
+ * main.c
+ *
+ * Runs a synthetic ROM on the patched opcode dispatcher and prints a trace of
+ * the divider, timer, LCD mode and interrupt events (cycle and pc). Built with
+ * and without BATCH_EXECUTION, the traces have to be identical.
+ *
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#include "gameboy_ub.h"
+#include "z80_opcode_goto.h"
+#include "z80_ub.h"
+
+#define RUN_CYCLES 2000000
+
+z80_t z80;
+Shadow_t Shadow;
+uint32_t memoryControllerBankOffset;
+uint8_t rom[0x10000];
+static uint8_t ram[0x8000];
+
+static uint64_t totalCycles;
+static uint32_t steps;
+
+static const uint32_t timerCycles[4] = {1024, 16, 64, 256};
+
+void WR_IO(uint16_t adr, uint8_t value) {
+#if BATCH_EXECUTION
+  // Same rule as WR_BYTE_MEM() in gameboy_ub.c
+  if (adr < 0xFF80 || adr == IE_ADR) {
+    totalCycles += z80_batch_cycles;
+    z80_batch_flush();
+  }
+#endif
+  z80.memory[adr - ROM_SIZE] = value;
+  if (adr == TAC_ADR) {
+    Shadow.tim_enable = value & 0x04;
+    Shadow.tim_cycl_ovf = timerCycles[value & 0x03];
+    Shadow.tim_cycl_cnt = 0;
+  } else if (adr == LCDC_ADR) {
+    Shadow.mcu_cycl_cnt = 0;
+    Shadow.lcd_mode = 2;
+  }
+}
+
+static void printEvent(char event) {
+  printf("%c %llu %04x\n", event, (unsigned long long)totalCycles, z80.reg.pc);
+}
+
+// The bookkeeping of gameboy_single_step(), once per z80_single_step()
+static void singleStep(void) {
+  steps++;
+  z80_single_step();
+  totalCycles += z80.cycles;
+
+  if (Shadow.tim_enable) {
+    Shadow.tim_cycl_cnt += z80.cycles;
+    if (Shadow.tim_cycl_cnt >= Shadow.tim_cycl_ovf) {
+      Shadow.tim_cycl_cnt = 0;
+      z80.memory[IF_ADR - ROM_SIZE] |= 0x04;
+      printEvent('T');
+    }
+  }
+
+  Shadow.div_cycl_cnt += z80.cycles;
+  if (Shadow.div_cycl_cnt >= DIV_COUNTER_CYCLES) {
+    Shadow.div_cycl_cnt = 0;
+    printEvent('D');
+  }
+
+  uint32_t lcdCycles = LCD_LINE_CYCLES;
+  if (Shadow.lcd_mode == 2) {
+    lcdCycles = LCD_MODE2_CYCLES;
+  } else if (Shadow.lcd_mode == 3) {
+    lcdCycles = LCD_MODE3_CYCLES;
+  } else if (Shadow.lcd_mode == 0) {
+    lcdCycles = LCD_MODE0_CYCLES;
+  }
+  Shadow.mcu_cycl_cnt += z80.cycles;
+  if (Shadow.mcu_cycl_cnt >= lcdCycles) {
+    Shadow.mcu_cycl_cnt = 0;
+    Shadow.lcd_mode =
+        (Shadow.lcd_mode == 2) ? 3 : (Shadow.lcd_mode == 3) ? 0 : 2;
+    printEvent('L');
+  }
+
+  // Timer interrupt to 0x50
+  if (z80.ime_flag &&
+      (z80.memory[IE_ADR - ROM_SIZE] & z80.memory[IF_ADR - ROM_SIZE] & 0x04)) {
+    z80.memory[IF_ADR - ROM_SIZE] &= ~0x04;
+    z80.ime_flag = 0;
+    z80.ret = z80.reg.pc;
+    z80.reg.pc = 0x50;
+    printEvent('I');
+  }
+}
+
+static void writeRom(uint16_t adr, const uint8_t* code, uint32_t length) {
+  for (uint32_t n = 0; n < length; n++) {
+    rom[adr + n] = code[n];
+  }
+}
+
+static void buildRom(void) {
+  // Random 1 byte opcodes, ld a,n and the 0xCB prefix
+  uint32_t seed = 1;
+  for (uint32_t adr = 0x100; adr < ROM_SIZE; adr++) {
+    seed = seed * 1103515245 + 12345;
+    rom[adr] = (seed >> 16) & 0x4F;
+  }
+
+  // Timer at 262144 Hz, enable its interrupt
+  const uint8_t start[] = {0x3E, 0x05, 0xE0, 0x07,  // ld a,5; ldh (TAC),a
+                           0x3E, 0x04, 0xE0, 0xFF,  // ld a,4; ldh (IE),a
+                           0xFB};                   // ei
+  writeRom(0x100, start, sizeof(start));
+
+  // Jumps back after the start, the blocks get cached
+  const uint8_t loop[] = {0xC3, 0x09, 0x01};  // jp 0x109
+  for (uint32_t adr = 0x180; adr < ROM_SIZE; adr += 0x80) {
+    writeRom(adr, loop, sizeof(loop));
+  }
+
+  // LCD register writes in the middle of a batch
+  const uint8_t lcd[] = {0x3E, 0x91, 0xE0, 0x40,  // ld a,0x91; ldh (LCDC),a
+                         0xCB, 0x11};             // rl c
+  for (uint32_t adr = 0x140; adr < ROM_SIZE; adr += 0x200) {
+    writeRom(adr, lcd, sizeof(lcd));
+  }
+
+  const uint8_t isr[] = {0x00, 0x10, 0x00, 0xD9};  // ...; reti
+  writeRom(0x50, isr, sizeof(isr));
+}
+
+int main(void) {
+  buildRom();
+  z80.memory = ram;
+  z80.reg.pc = 0x100;
+  Shadow.lcd_mode = 2;
+
+  while (totalCycles < RUN_CYCLES) {
+    singleStep();
+  }
+  printEvent('E');
+  fprintf(stderr, "%u steps\n", steps);
+  return 0;
+}
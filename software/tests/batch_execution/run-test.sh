@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Host comparison of the batch execution (BATCH_EXECUTION) against stepping
+# one instruction at a time. Applies scripts/patches/z80_opcode_goto-h.patch,
+# builds it with the mock CPU core of this directory and compares the event
+# traces of the same run with and without batching (and the block cache).
+#
+#   tests/batch_execution/run-test.sh
+#
+# Author: TU Delft Sustainable Systems Laboratory
+# License: MIT License
+
+set -e
+
+testpath=$(cd "$(dirname "$0")" && pwd)
+patches=$testpath/../../scripts/patches
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+: > "$build/z80_opcode_goto.h"
+patch -s "$build/z80_opcode_goto.h" < "$patches/z80_opcode_goto-h.patch"
+
+CC=${CC:-cc}
+build_run() {
+    name=$1
+    shift
+    $CC -std=gnu99 -O1 -Wall -Wno-unused-function -Wno-unused-variable \
+        -I"$testpath" -I"$build" "$@" "$testpath/main.c" -o "$build/$name"
+    echo "$name: $("$build/$name" 2>&1 > "$build/$name.txt")"
+}
+
+build_run step -DBATCH_EXECUTION=0 -DBLOCK_CACHE=0
+build_run batch -DBATCH_EXECUTION=1 -DBLOCK_CACHE=0
+build_run batch_block -DBATCH_EXECUTION=1 -DBLOCK_CACHE=1
+
+result=0
+for name in batch batch_block; do
+    if cmp -s "$build/step.txt" "$build/$name.txt"; then
+        echo "$name: $(wc -l < "$build/step.txt") events match"
+    else
+        echo "$name: trace differs from stepping"
+        diff "$build/step.txt" "$build/$name.txt" | head -10
+        result=1
+    fi
+done
+exit $result
@@ -0,0 +1,19 @@
+/*
+ * z80_opcode_cb_func.h
+ *
+ * Mock 0xCB prefixed opcodes, they only skip the two opcode bytes.
+ *
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef Z80_OPCODE_CB_FUNC_H_
+#define Z80_OPCODE_CB_FUNC_H_
+
+#include "z80_ub.h"
+
+#define MOCK_OPCODE_CB(opcode) \
+  static inline void op1_##opcode(void) { z80.reg.pc += 2; }
+MOCK_OPCODES(MOCK_OPCODE_CB)
+
+#endif /* Z80_OPCODE_CB_FUNC_H_ */
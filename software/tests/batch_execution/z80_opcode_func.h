@@ -0,0 +1,48 @@
+/*
+ * z80_opcode_func.h
+ *
+ * Mock opcodes: the ones the test ROM relies on, the others only skip their
+ * opcode byte. The cycles come from cycles[] like in the emulator.
+ *
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef Z80_OPCODE_FUNC_H_
+#define Z80_OPCODE_FUNC_H_
+
+#include "z80_ub.h"
+
+static inline void mock_opcode(uint8_t opcode) {
+  switch (opcode) {
+    case 0x3e:  // ld a,n
+      z80.reg.a = RD_BYTE_MEM(z80.reg.pc + 1);
+      z80.reg.pc += 2;
+      break;
+    case 0xc3:  // jp nn
+      z80.reg.pc =
+          RD_BYTE_MEM(z80.reg.pc + 1) | (RD_BYTE_MEM(z80.reg.pc + 2) << 8);
+      break;
+    case 0xd9:  // reti
+      z80.reg.pc = z80.ret;
+      z80.ime_flag = 1;
+      break;
+    case 0xe0:  // ldh (n),a
+      z80.reg.pc += 2;
+      WR_IO(0xFF00 | RD_BYTE_MEM(z80.reg.pc - 1), z80.reg.a);
+      break;
+    case 0xfb:  // ei
+      z80.reg.pc += 1;
+      z80.ime_flag = 1;
+      break;
+    default:
+      z80.reg.pc += 1;
+      break;
+  }
+}
+
+#define MOCK_OPCODE(opcode) \
+  static inline void op0_##opcode(void) { mock_opcode(opcode); }
+MOCK_OPCODES(MOCK_OPCODE)
+
+#endif /* Z80_OPCODE_FUNC_H_ */
@@ -0,0 +1,84 @@
+/*
+ * z80_ub.h
+ *
+ * Mock of the CPU core for the host test of the batch execution, only what
+ * the patched z80_opcode_goto.h uses.
+ *
+ *      Author: TU Delft Sustainable Systems Laboratory
+ *     License: MIT License
+ */
+
+#ifndef Z80_UB_H_
+#define Z80_UB_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define OPCODE_GOTO 1
+#ifndef BLOCK_CACHE
+#define BLOCK_CACHE 1
+#endif
+#ifndef BATCH_EXECUTION
+#define BATCH_EXECUTION 1
+#endif
+#define BLOCK_CACHE_SIZE 256
+#define BLOCK_MAX_LENGTH 8
+#define BLOCK_MAX_CYCLES 32
+
+#define SUPPORTED_MBC_VERSION 1
+#define ROM_SIZE 0x8000
+#define MBC1_RD_BANKN 0x4000
+#define MBC1_RD_BANK_SIZE 0x4000
+
+typedef struct {
+  struct {
+    uint16_t pc;
+    uint8_t a;
+  } reg;
+  uint8_t opcode;
+  uint16_t cycles;
+  uint8_t ime_flag;
+  uint8_t halt_mode;
+  uint8_t status;
+  uint16_t ret;  // return address of the mock interrupt
+  uint8_t* memory;
+} z80_t;
+
+extern z80_t z80;
+extern uint32_t memoryControllerBankOffset;
+extern uint8_t rom[0x10000];
+
+static inline uint8_t RD_BYTE_MEM(uint16_t adr) {
+  if (adr < MBC1_RD_BANKN) {
+    return rom[adr];
+  }
+  return rom[memoryControllerBankOffset + adr];
+}
+
+// Registers 0xFF00..0xFFFF, ends the batch like WR_BYTE_MEM() does
+void WR_IO(uint16_t adr, uint8_t value);
+
+static const uint8_t cycles[256] = {
+    [0x00 ... 0xff] = 4, [0x10 ... 0x3f] = 8, [0x40 ... 0x4f] = 12,
+    [0xc3] = 16,         [0xd9] = 16,         [0xe0] = 12,
+};
+static const uint8_t cycles_cb[256] = {[0x00 ... 0xff] = 8};
+
+// Defines the opcode functions 0x<row>0..0x<row>f with define(opcode)
+#define MOCK_OPCODE_ROW(define, row)                                   \
+  define(row##0) define(row##1) define(row##2) define(row##3)          \
+  define(row##4) define(row##5) define(row##6) define(row##7)          \
+  define(row##8) define(row##9) define(row##a) define(row##b)          \
+  define(row##c) define(row##d) define(row##e) define(row##f)
+
+#define MOCK_OPCODES(define)                                           \
+  MOCK_OPCODE_ROW(define, 0x0) MOCK_OPCODE_ROW(define, 0x1)            \
+  MOCK_OPCODE_ROW(define, 0x2) MOCK_OPCODE_ROW(define, 0x3)            \
+  MOCK_OPCODE_ROW(define, 0x4) MOCK_OPCODE_ROW(define, 0x5)            \
+  MOCK_OPCODE_ROW(define, 0x6) MOCK_OPCODE_ROW(define, 0x7)            \
+  MOCK_OPCODE_ROW(define, 0x8) MOCK_OPCODE_ROW(define, 0x9)            \
+  MOCK_OPCODE_ROW(define, 0xa) MOCK_OPCODE_ROW(define, 0xb)            \
+  MOCK_OPCODE_ROW(define, 0xc) MOCK_OPCODE_ROW(define, 0xd)            \
+  MOCK_OPCODE_ROW(define, 0xe) MOCK_OPCODE_ROW(define, 0xf)
+
+#endif /* Z80_UB_H_ */